@@ -1,5 +1,6 @@
 #pragma once
 #include "Renderer.h"
+#include <util/SceneSnapshot.h>
 
 /// @brief Scene base class. **Run `cmake . -B build` after adding new files to the scenes folder**
 ///
@@ -12,16 +13,46 @@ class Scene
 {
 public:
     /// @brief Initialize the scene. Gets called every time the scene is switched to.
+    ///
+    /// Runs on a background thread while the previous scene keeps running, so do not call ImGui or the Renderer here.
     virtual void init() {};
-    /// @brief Simulate a step in the scene. Gets called every frame before onDraw.
+    /// @brief Simulate a step in the scene. Gets called before onDraw, once per frame, or zero or more times with "Fixed Timestep".
     ///
     /// This is where you should update the physics of the scene.
+    /// Advance the simulation by `timestep` seconds per call.
+    /// With "Pipelined Simulation" enabled this and onDraw run on a worker thread, so only call ImGui in onGUI.
     virtual void simulateStep() {};
     /// @brief Draw the scene. Gets called every frame after simulateStep.
     ///
     /// This is where you should call the Renderer draw functions.
+    /// Use `interpolationAlpha` to blend between the previous and the current state.
     virtual void onDraw(Renderer &renderer);
     /// @brief Define the GUI for the scene. Gets called every frame after onDraw.
     virtual void onGUI() {};
+    /// @brief Write everything needed to continue the simulation from the current state, e.g. positions, velocities and parameters.
+    ///
+    /// Write large arrays with a single `writer.write(vector)` call, they are restored with one copy.
+    /// @return
+    ///    false if the scene does not support snapshots
+    virtual bool saveState(StateWriter &) { return false; };
+    /// @brief Restore a state written by saveState, in the same order. Only called on an initialized scene, replaces re-running init().
+    /// @return
+    ///    false if the state could not be restored
+    virtual bool loadState(StateReader &) { return false; };
+    /// @brief Set a named parameter for headless batch runs, e.g. `--param stiffness=10,20,40`. Gets called before init.
+    /// @return
+    ///    false if the scene has no parameter with this name
+    virtual bool setParameter(const std::string &, double) { return false; };
     virtual ~Scene() = default;
+
+    /// @brief The simulated time per simulateStep call in seconds. Set by the Simulator before stepping.
+    float timestep = 1.0f / 60.0f;
+    /// @brief Lowest physics rate in Hz the scene stays stable at. The adaptive rate never goes below it, even over budget.
+    float minPhysicsRate = 1.0f;
+    /// @brief Highest physics rate in Hz worth simulating, e.g. because smaller timesteps do not improve the result.
+    float maxPhysicsRate = 10000.0f;
+    /// @brief Simulated time that has not been stepped yet, as a fraction of `timestep` in [0, 1). Set by the Simulator before onDraw.
+    ///
+    /// The rendered frame lies between the last and the next simulateStep by this fraction.
+    float interpolationAlpha = 0;
 };
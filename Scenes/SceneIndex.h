@@ -12,7 +12,7 @@ SceneCreator creator()
     { return std::make_unique<T>(); };
 }
 
-std::map<std::string, SceneCreator> scenesCreators = {
+inline std::map<std::string, SceneCreator> scenesCreators = {
     {"Demo Scene", creator<Scene1>()},
     // add more Scene types here
 };
@@ -0,0 +1,1588 @@
+// standalone correctness and speed check of the box narrowphase, built with -DBUILD_COLLISION_BENCH=ON
+//
+// Runs the reference cases of testCheckCollision as assertions, then tests randomized box pairs with every
+// variant of checkCollisionSAT and compares them to the original allocating implementation, which is kept
+// below as referenceSAT. All variants have to give bitwise identical results.
+// The broadphases and scene queries are compared with testing every pair of bodies or every box.
+// GJK, EPA, the collision kernels and the time of impact are compared with the geometry of the shapes and with
+// checkCollisionSAT at many points of the step. The contact cache has to carry the impulses of the manifold points
+// from step to step by feature id, for the pairs in either order and through missed steps.
+//
+// CollisionBench [--pairs count] [--bodies count] [--steps count] [--shapes count] [--threads count] [--seed value] [--help]
+#include <util/CollisionDetection.h>
+#include <util/SweepAndPrune.h>
+#include <util/SpatialHashGrid.h>
+#include <util/DynamicAABBTree.h>
+#include <util/SceneQuery.h>
+#include <util/CollisionKernels.h>
+#include <util/GJK.h>
+#include <util/TimeOfImpact.h>
+#include <util/ContactCache.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace collisionTools;
+
+// every allocation of the program is counted, so the table can show which variants allocate per pair
+static std::atomic<size_t> allocationCount{0};
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+// not inlined, GCC would otherwise see the free of a pointer from operator new and warn about the mismatch
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { ::operator delete(p); }
+
+namespace
+{
+    // the original checkCollisionSAT, before the OBB path existed, only built from the public helpers
+    // it recomputes corners and axes with std::vector for every projection, which is what the variants are measured against
+    glm::vec3 referenceContactPoint(const glm::vec3 &pOne, const glm::vec3 &dOne, float oneSize,
+                                    const glm::vec3 &pTwo, const glm::vec3 &dTwo, float twoSize, bool useOne)
+    {
+        float smOne = glm::length2(dOne);
+        float smTwo = glm::length2(dTwo);
+        float dpOneTwo = glm::dot(dTwo, dOne);
+
+        glm::vec3 toSt = pOne - pTwo;
+        float dpStaOne = glm::dot(dOne, toSt);
+        float dpStaTwo = glm::dot(dTwo, toSt);
+
+        float denom = smOne * smTwo - dpOneTwo * dpOneTwo;
+        if (glm::abs(denom) < 0.0001f)
+            return useOne ? pOne : pTwo;
+
+        float mua = (dpOneTwo * dpStaTwo - smTwo * dpStaOne) / denom;
+        float mub = (smOne * dpStaTwo - dpOneTwo * dpStaOne) / denom;
+        if (mua > oneSize || mua < -oneSize || mub > twoSize || mub < -twoSize)
+            return useOne ? pOne : pTwo;
+
+        glm::vec3 cOne = pOne + dOne * mua;
+        glm::vec3 cTwo = pTwo + dTwo * mub;
+        return cOne * 0.5f + cTwo * 0.5f;
+    }
+
+    CollisionInfo referenceSAT(const glm::mat4 &worldFromObj_A, const glm::mat4 &worldFromObj_B)
+    {
+        glm::vec3 size_A = getBoxSize(worldFromObj_A);
+        glm::vec3 size_B = getBoxSize(worldFromObj_B);
+        CollisionInfo info;
+        info.isColliding = false;
+        float smallOverlap = 10000.0f;
+        glm::vec3 axis = glm::vec3(0.0);
+        int fromWhere = -1;
+        int whichEdges = 0;
+        bool bestSingleAxis = false;
+        glm::vec3 toCenter = getVectorConnnectingCenters(worldFromObj_A, worldFromObj_B);
+        std::vector<glm::vec3> axes[3] = {getAxisNormalToFaces(worldFromObj_A), getAxisNormalToFaces(worldFromObj_B),
+                                          getPairOfEdges(worldFromObj_A, worldFromObj_B)};
+        for (int set = 0; set < 3; set++)
+        {
+            for (int i = 0; i < (int)axes[set].size(); i++)
+            {
+                Projection p1 = project(worldFromObj_A, axes[set][i]);
+                Projection p2 = project(worldFromObj_B, axes[set][i]);
+                if (!overlap(p1, p2))
+                    return info;
+                float o = getOverlap(p1, p2);
+                if (o < smallOverlap)
+                {
+                    smallOverlap = o;
+                    axis = axes[set][i];
+                    fromWhere = set;
+                    if (set == 1)
+                        bestSingleAxis = true;
+                    if (set == 2)
+                        whichEdges = i;
+                }
+            }
+        }
+
+        glm::vec3 normal;
+        glm::vec3 collisionPoint = glm::vec3(0.0);
+        if (fromWhere == 0 || fromWhere == 1)
+        {
+            normal = axis;
+            if (glm::dot(axis, toCenter) <= 0)
+                normal = -normal;
+            collisionPoint = fromWhere == 0 ? handleVertexToface(worldFromObj_B, toCenter)
+                                            : handleVertexToface(worldFromObj_A, toCenter * -1.0f);
+        }
+        else if (fromWhere == 2)
+        {
+            const std::vector<glm::vec3> &axes1 = axes[0], &axes2 = axes[1];
+            normal = glm::normalize(glm::cross(axes1[whichEdges / 3], axes2[whichEdges % 3]));
+            if (glm::dot(normal, toCenter) <= 0)
+                normal = -normal;
+            glm::vec4 ptOnOneEdge = glm::vec4(0.5, 0.5, 0.5, 1);
+            glm::vec4 ptOnTwoEdge = glm::vec4(0.5, 0.5, 0.5, 1);
+            for (int i = 0; i < 3; i++)
+            {
+                if (i == whichEdges / 3)
+                    ptOnOneEdge[i] = 0;
+                else if (glm::dot(axes1[i], normal) < 0)
+                    ptOnOneEdge[i] = -ptOnOneEdge[i];
+
+                if (i == whichEdges % 3)
+                    ptOnTwoEdge[i] = 0;
+                else if (glm::dot(axes2[i], normal) > 0)
+                    ptOnTwoEdge[i] = -ptOnTwoEdge[i];
+            }
+            ptOnOneEdge = worldFromObj_A * ptOnOneEdge;
+            ptOnTwoEdge = worldFromObj_B * ptOnTwoEdge;
+            collisionPoint = referenceContactPoint(ptOnOneEdge, axes1[whichEdges / 3], size_A[whichEdges / 3],
+                                                   ptOnTwoEdge, axes2[whichEdges % 3], size_B[whichEdges % 3], bestSingleAxis);
+        }
+
+        info.isColliding = true;
+        info.collisionPointWorld = collisionPoint;
+        info.depth = smallOverlap;
+        info.normalWorld = -normal;
+        return info;
+    }
+
+    // fields of separated pairs are unspecified, bitwise so NaNs from degenerate edge axes compare as well
+    bool sameResult(const CollisionInfo &a, const CollisionInfo &b)
+    {
+        if (a.isColliding != b.isColliding)
+            return false;
+        if (!a.isColliding)
+            return true;
+        return std::memcmp(&a.collisionPointWorld, &b.collisionPointWorld, sizeof(glm::vec3)) == 0 &&
+               std::memcmp(&a.normalWorld, &b.normalWorld, sizeof(glm::vec3)) == 0 &&
+               std::memcmp(&a.depth, &b.depth, sizeof(float)) == 0;
+    }
+
+    bool sameManifold(const ContactManifold &a, const ContactManifold &b)
+    {
+        if (a.isColliding != b.isColliding || a.pointCount != b.pointCount)
+            return false;
+        if (!a.isColliding)
+            return true;
+        if (std::memcmp(&a.normalWorld, &b.normalWorld, sizeof(glm::vec3)) != 0)
+            return false;
+        for (int i = 0; i < a.pointCount; i++)
+        {
+            if (std::memcmp(&a.points[i].positionWorld, &b.points[i].positionWorld, sizeof(glm::vec3)) != 0 ||
+                std::memcmp(&a.points[i].depth, &b.points[i].depth, sizeof(float)) != 0 ||
+                a.points[i].featureId != b.points[i].featureId)
+                return false;
+        }
+        return true;
+    }
+
+    // the manifold runs the same test, but keeps a face axis over a slightly better edge axis, so only the
+    // collision flag has to match exactly, and the normal if it is the one checkCollisionSAT found or a face axis
+    bool manifoldMatches(const ContactManifold &manifold, const CollisionInfo &info, const OBB &box_A, const OBB &box_B)
+    {
+        if (manifold.isColliding != info.isColliding)
+            return false;
+        if (!info.isColliding)
+            return true;
+        if (manifold.pointCount < 1 || manifold.pointCount > ContactManifold::maxPoints)
+            return false;
+        if (std::memcmp(&manifold.normalWorld, &info.normalWorld, sizeof(glm::vec3)) == 0)
+            return true;
+        for (int i = 0; i < 3; i++)
+        {
+            if (glm::abs(glm::abs(glm::dot(manifold.normalWorld, box_A.axes[i])) - 1.0f) < 1e-5f ||
+                glm::abs(glm::abs(glm::dot(manifold.normalWorld, box_B.axes[i])) - 1.0f) < 1e-5f)
+                return true;
+        }
+        return false;
+    }
+
+    enum PairKind
+    {
+        Overlapping,
+        Touching,
+        Separated,
+        Degenerate,
+        pairKindCount
+    };
+
+    const char *pairKindNames[pairKindCount] = {"overlapping", "touching", "separated", "degenerate"};
+
+    glm::quat randomRotation(std::mt19937 &rng)
+    {
+        std::normal_distribution<float> gauss;
+        glm::quat q(gauss(rng), gauss(rng), gauss(rng), gauss(rng));
+        float length = glm::length(q);
+        return length > 1e-6f ? q / length : glm::quat(1, 0, 0, 0);
+    }
+
+    // quarter turns about the object axes, the edges of both boxes stay parallel
+    glm::quat randomQuarterTurn(std::mt19937 &rng)
+    {
+        glm::vec3 axis(0.0f);
+        axis[rng() % 3] = 1.0f;
+        return glm::angleAxis(glm::radians(90.0f * (rng() % 4)), axis);
+    }
+
+    // adds bodies 2 * i and 2 * i + 1 to bodies, positioned as the pair kind asks for
+    void addPair(PairKind kind, std::mt19937 &rng, BodyTransforms &bodies)
+    {
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> extent(0.2f, 3.0f);
+        glm::vec3 position_A(unit(rng) * 10.0f, unit(rng) * 10.0f, unit(rng) * 10.0f);
+        glm::quat rotation_A = randomRotation(rng);
+        glm::vec3 scale_A(extent(rng), extent(rng), extent(rng));
+        glm::quat rotation_B = randomRotation(rng);
+        glm::vec3 scale_B(extent(rng), extent(rng), extent(rng));
+        glm::vec3 offset;
+
+        switch (kind)
+        {
+        case Overlapping:
+            offset = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.5f * glm::min(scale_A, scale_B);
+            break;
+        case Touching:
+        {
+            // B rests on a face of A with the same orientation up to quarter turns, so the faces touch up to rounding
+            rotation_B = rotation_A * randomQuarterTurn(rng);
+            glm::vec3 scaleInA = glm::abs(glm::mat3_cast(glm::inverse(rotation_A) * rotation_B) * scale_B);
+            int face = rng() % 3;
+            glm::vec3 local(unit(rng), unit(rng), unit(rng));
+            local *= 0.5f * glm::abs(scale_A - scaleInA);
+            local[face] = (rng() % 2 ? 0.5f : -0.5f) * (scale_A[face] + scaleInA[face]);
+            offset = rotation_A * local;
+            break;
+        }
+        case Separated:
+        {
+            // half of them far apart, the other half just out of reach along a face normal of A
+            if (rng() % 2)
+            {
+                float reach = 0.5f * (glm::length(scale_A) + glm::length(scale_B));
+                glm::vec3 direction = rotation_B * glm::vec3(1, 0, 0);
+                offset = direction * (reach * (1.01f + 0.5f * (unit(rng) + 1.0f)));
+            }
+            else
+            {
+                int face = rng() % 3;
+                glm::vec3 local(0.0f);
+                float radius_B = 0.5f * glm::length(scale_B);
+                local[face] = 0.5f * scale_A[face] + radius_B + 0.01f + 0.1f * (unit(rng) + 1.0f);
+                offset = rotation_A * local;
+            }
+            break;
+        }
+        case Degenerate:
+        default:
+        {
+            // parallel edges make the edge cross products zero, thin boxes make faces almost coincide
+            switch (rng() % 3)
+            {
+            case 0:
+                rotation_B = rotation_A;
+                break;
+            case 1:
+                rotation_B = rotation_A * glm::angleAxis(unit(rng) * 3.14159f, glm::vec3(0, 0, 1));
+                break;
+            default:
+                rotation_B = rotation_A * randomQuarterTurn(rng);
+                scale_B[rng() % 3] = 1e-3f;
+                break;
+            }
+            offset = glm::vec3(unit(rng), unit(rng), unit(rng)) * 0.5f * (scale_A + scale_B);
+            break;
+        }
+        }
+
+        bodies.positions.push_back(position_A);
+        bodies.rotations.push_back(rotation_A);
+        bodies.scales.push_back(scale_A);
+        bodies.positions.push_back(position_A + offset);
+        bodies.rotations.push_back(rotation_B);
+        bodies.scales.push_back(scale_B);
+    }
+
+    struct VariantStats
+    {
+        const char *name;
+        double nanoseconds = 0;
+        size_t allocations = 0;
+        size_t mismatches = 0;
+    };
+
+    // runs body over all pairs, adds its time and allocations to stats
+    template <typename Body>
+    void measure(VariantStats &stats, Body body)
+    {
+        size_t allocationsBefore = allocationCount.load();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        stats.allocations += allocationCount.load() - allocationsBefore;
+        stats.nanoseconds += std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    bool closeTo(glm::vec3 a, glm::vec3 b) { return glm::all(glm::lessThan(glm::abs(a - b), glm::vec3(1e-3f))); }
+
+    // the reference cases of testCheckCollision, with the results noted there
+    bool checkReferenceCases()
+    {
+        struct ReferenceCase
+        {
+            glm::mat4 worldFromObj_A, worldFromObj_B;
+            glm::vec3 normal, point;
+        };
+        using glm::mat4;
+        using glm::vec3;
+        float s = 5.656855f;
+        ReferenceCase cases[3] = {
+            {glm::translate(mat4(1.0), vec3(1.0, 1.0, 1.0)),
+             glm::translate(mat4(1.0), vec3(2.0, 2.0, 2.0)),
+             vec3(-1, 0, 0), vec3(1.5, 1.5, 1.5)},
+            {glm::translate(mat4(1.0), vec3(0.2, 5.0, 1.0)) * glm::scale(mat4(1.0), vec3(9.0, 2.0, 3.0)),
+             glm::rotate(mat4(1.0), glm::radians(45.0f), vec3(0, 0, 1)) * glm::scale(mat4(1.0), vec3(s, s, 2.0)),
+             vec3(0, 1, 0), vec3(0, 4, 1)},
+            {glm::translate(mat4(1.0), vec3(-2.0, 0.0, 1.0)) * glm::rotate(mat4(1.0), glm::radians(45.0f), vec3(0, 0, 1)) * glm::scale(mat4(1.0), vec3(2.829f, 2.829f, 2.0f)),
+             glm::translate(mat4(1.0), vec3(1.0, 0.5, 0.0)) * glm::rotate(mat4(1.0), glm::radians(90.0f), vec3(0, 0, 1)) * glm::scale(mat4(1.0), vec3(9.0f, 2.0f, 4.0f)),
+             vec3(-1, 0, 0), vec3(0.000405, 0, 0)},
+        };
+        bool passed = true;
+        for (int i = 0; i < 3; i++)
+        {
+            const ReferenceCase &c = cases[i];
+            CollisionInfo reference = referenceSAT(c.worldFromObj_A, c.worldFromObj_B);
+            CollisionInfo info = checkCollisionSAT(c.worldFromObj_A, c.worldFromObj_B);
+            bool ok = info.isColliding && closeTo(info.normalWorld, c.normal) && closeTo(info.collisionPointWorld, c.point) && sameResult(info, reference);
+            std::cout << "reference case " << i + 1 << ": " << (ok ? "passed" : "FAILED") << std::endl;
+            if (!ok)
+            {
+                std::cerr << "  expected normal " << c.normal.x << ", " << c.normal.y << ", " << c.normal.z
+                          << " point " << c.point.x << ", " << c.point.y << ", " << c.point.z << std::endl;
+                std::cerr << "  got normal " << info.normalWorld.x << ", " << info.normalWorld.y << ", " << info.normalWorld.z
+                          << " point " << info.collisionPointWorld.x << ", " << info.collisionPointWorld.y << ", " << info.collisionPointWorld.z << std::endl;
+                passed = false;
+            }
+        }
+        return passed;
+    }
+}
+
+namespace
+{
+    // prints one table of checks, returns false if any of them found a mismatch
+    bool printChecks(const char *title, const char *unit, const VariantStats *checks, size_t checkCount, const size_t *runs)
+    {
+        std::cout << std::endl
+                  << std::left << std::setw(28) << title << std::right << std::setw(12) << "runs" << std::setw(14) << unit
+                  << std::setw(16) << "allocs/run" << std::setw(12) << "mismatches" << std::endl;
+        bool passed = true;
+        for (size_t i = 0; i < checkCount; i++)
+        {
+            size_t divisor = std::max<size_t>(runs[i], 1);
+            std::cout << std::left << std::setw(28) << checks[i].name << std::right << std::fixed
+                      << std::setw(12) << runs[i]
+                      << std::setw(14) << std::setprecision(3) << checks[i].nanoseconds / divisor / 1000.0
+                      << std::setw(16) << std::setprecision(1) << double(checks[i].allocations) / divisor
+                      << std::setw(12) << checks[i].mismatches << std::endl;
+            if (checks[i].mismatches > 0)
+                passed = false;
+        }
+        return passed;
+    }
+
+    // mostly similar sizes, with a few large bodies for the large body path of the grid and flat ones that only touch
+    AABB randomBounds(std::mt19937 &rng, float worldSize)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        glm::vec3 center = (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * worldSize;
+        glm::vec3 extent(0.2f + 1.3f * unit(rng), 0.2f + 1.3f * unit(rng), 0.2f + 1.3f * unit(rng));
+        float kind = unit(rng);
+        if (kind < 0.03f)
+            extent *= 10.0f;
+        else if (kind < 0.06f)
+            extent[rng() % 3] = 0.0f;
+        return {center - 0.5f * extent, center + 0.5f * extent};
+    }
+
+    bool samePairs(const std::vector<BodyPair> &a, const std::vector<BodyPair> &b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (a[i].a != b[i].a || a[i].b != b[i].b)
+                return false;
+        }
+        return true;
+    }
+
+    // compares SweepAndPrune, SpatialHashGrid and DynamicAABBTree with all pairs tested against each other,
+    // while bodies move, teleport, disappear and come back from step to step
+    bool checkBroadphases(size_t bodyCount, size_t steps, unsigned seed, ThreadPool &pool)
+    {
+        enum Check
+        {
+            BruteForce,
+            SAP,
+            Grid,
+            Tree,
+            TreeQuery,
+            TreeHeapStack,
+            checkCount
+        };
+        VariantStats checks[checkCount] = {
+            {"brute force pairs"},
+            {"SweepAndPrune"},
+            {"SpatialHashGrid"},
+            {"DynamicAABBTree"},
+            {"DynamicAABBTree::query"},
+            {"query, heap stack"},
+        };
+        size_t runs[checkCount] = {};
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        // the density of the bodies stays the same for any count
+        float worldSize = 4.0f * std::cbrt(static_cast<float>(bodyCount));
+
+        std::vector<AABB> bounds(bodyCount);
+        std::vector<uint8_t> alive(bodyCount, 1), isStatic(bodyCount, 0);
+        std::vector<int32_t> proxies(bodyCount, DynamicAABBTree::nullNode);
+        SweepAndPrune sweepAndPrune;
+        SpatialHashGrid grid(0, &pool);
+        DynamicAABBTree tree;
+        for (uint32_t body = 0; body < bodyCount; body++)
+        {
+            bounds[body] = randomBounds(rng, worldSize);
+            isStatic[body] = unit(rng) < 0.1f;
+            sweepAndPrune.add(body, bounds[body]);
+            proxies[body] = tree.insert(body, bounds[body], isStatic[body]);
+        }
+
+        std::vector<BodyPair> expected, expectedTree, gridPairs;
+        std::vector<AABB> gridBounds;
+        std::vector<uint32_t> gridBodies;
+        std::vector<int32_t> found[3];
+        std::vector<int32_t> expectedProxies;
+        for (size_t step = 0; step < steps; step++)
+        {
+            // churn: small moves of the dynamic bodies, a few teleports, removals and additions
+            for (uint32_t body = 0; body < bodyCount; body++)
+            {
+                float action = unit(rng);
+                if (!alive[body])
+                {
+                    if (action < 0.3f)
+                    {
+                        alive[body] = 1;
+                        bounds[body] = randomBounds(rng, worldSize);
+                        sweepAndPrune.add(body, bounds[body]);
+                        proxies[body] = tree.insert(body, bounds[body], isStatic[body]);
+                    }
+                    continue;
+                }
+                if (action < 0.01f)
+                {
+                    alive[body] = 0;
+                    sweepAndPrune.remove(body);
+                    tree.remove(proxies[body]);
+                    proxies[body] = DynamicAABBTree::nullNode;
+                    continue;
+                }
+                if (isStatic[body])
+                    continue;
+                glm::vec3 offset = action < 0.03f ? randomBounds(rng, worldSize).center() - bounds[body].center()
+                                                  : (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * 0.3f;
+                bounds[body] = {bounds[body].min + offset, bounds[body].max + offset};
+                sweepAndPrune.update(body, bounds[body]);
+                tree.update(proxies[body], bounds[body]);
+            }
+
+            measure(checks[BruteForce], [&]
+                    {
+                        expected.clear();
+                        for (uint32_t a = 0; a < bodyCount; a++)
+                        {
+                            if (!alive[a])
+                                continue;
+                            for (uint32_t b = a + 1; b < bodyCount; b++)
+                            {
+                                if (alive[b] && bounds[a].overlaps(bounds[b]))
+                                    expected.push_back({a, b});
+                            }
+                        } });
+            runs[BruteForce]++;
+            // the tree never pairs two static bodies
+            expectedTree.clear();
+            for (const BodyPair &pair : expected)
+            {
+                if (!isStatic[pair.a] || !isStatic[pair.b])
+                    expectedTree.push_back(pair);
+            }
+
+            const std::vector<BodyPair> *pairs = nullptr;
+            measure(checks[SAP], [&]
+                    { pairs = &sweepAndPrune.findPairs(); });
+            runs[SAP]++;
+            checks[SAP].mismatches += !samePairs(*pairs, expected);
+
+            // the grid is rebuilt from the living bodies, in ascending order so the mapped pairs stay sorted
+            gridBounds.clear();
+            gridBodies.clear();
+            for (uint32_t body = 0; body < bodyCount; body++)
+            {
+                if (alive[body])
+                {
+                    gridBounds.push_back(bounds[body]);
+                    gridBodies.push_back(body);
+                }
+            }
+            measure(checks[Grid], [&]
+                    {
+                        grid.build(gridBounds);
+                        pairs = &grid.findPairs(); });
+            runs[Grid]++;
+            gridPairs.clear();
+            for (const BodyPair &pair : *pairs)
+                gridPairs.push_back({gridBodies[pair.a], gridBodies[pair.b]});
+            checks[Grid].mismatches += !samePairs(gridPairs, expected);
+
+            measure(checks[Tree], [&]
+                    { pairs = &tree.findPairs(); });
+            runs[Tree]++;
+            checks[Tree].mismatches += !samePairs(*pairs, expectedTree);
+
+            // queries against the fat bounds, with inline stacks small enough that the traversal has to grow on the heap twice
+            for (int query = 0; query < 16; query++)
+            {
+                AABB region = randomBounds(rng, worldSize).expanded(2.0f * unit(rng));
+                expectedProxies.clear();
+                for (uint32_t body = 0; body < bodyCount; body++)
+                {
+                    if (alive[body] && tree.fatBounds(proxies[body]).overlaps(region))
+                        expectedProxies.push_back(proxies[body]);
+                }
+                for (auto &list : found)
+                    list.clear();
+                measure(checks[TreeQuery], [&]
+                        { tree.query(region, [&](int32_t proxy)
+                                     { found[0].push_back(proxy); }); });
+                measure(checks[TreeHeapStack], [&]
+                        {
+                            tree.query<1>(region, [&](int32_t proxy)
+                                          { found[1].push_back(proxy); });
+                            tree.query<3>(region, [&](int32_t proxy)
+                                          { found[2].push_back(proxy); }); });
+                runs[TreeQuery]++;
+                runs[TreeHeapStack] += 2;
+                std::sort(expectedProxies.begin(), expectedProxies.end());
+                for (int i = 0; i < 3; i++)
+                {
+                    std::sort(found[i].begin(), found[i].end());
+                    if (found[i] != expectedProxies)
+                        checks[i == 0 ? TreeQuery : TreeHeapStack].mismatches++;
+                }
+            }
+        }
+
+        std::cout << std::endl
+                  << bodyCount << " bodies, " << steps << " steps of churn, tree height " << tree.height() << std::endl;
+        return printChecks("broadphase", "us/run", checks, checkCount, runs);
+    }
+
+    // distance along the ray to the box, FLT_MAX if it misses within ray.maxDistance, the slab test in box space
+    float rayBoxDistance(const OBB &box, const Ray &ray)
+    {
+        float entry = 0, exit = ray.maxDistance;
+        for (int i = 0; i < 3; i++)
+        {
+            float e = glm::dot(box.axes[i], box.center - ray.origin);
+            float f = glm::dot(box.axes[i], ray.direction);
+            if (glm::abs(f) > 1e-9f)
+            {
+                float t1 = (e - box.halfExtents[i]) / f, t2 = (e + box.halfExtents[i]) / f;
+                entry = std::max(entry, std::min(t1, t2));
+                exit = std::min(exit, std::max(t1, t2));
+                if (entry > exit)
+                    return FLT_MAX;
+            }
+            else if (glm::abs(e) > box.halfExtents[i])
+                return FLT_MAX;
+        }
+        return entry;
+    }
+
+    float boxDistance(const OBB &box, glm::vec3 point)
+    {
+        glm::vec3 toPoint = point - box.center, closest(0.0f);
+        for (int i = 0; i < 3; i++)
+            closest += box.axes[i] * glm::clamp(glm::dot(toPoint, box.axes[i]), -box.halfExtents[i], box.halfExtents[i]);
+        return glm::length(toPoint - closest);
+    }
+
+    // compares the ray casts and overlap queries of SceneQuery with testing every box
+    bool checkSceneQueries(size_t bodyCount, unsigned seed, ThreadPool &pool)
+    {
+        enum Check
+        {
+            BruteForceRays,
+            Rays,
+            BatchedRays,
+            Spheres,
+            Boxes,
+            checkCount
+        };
+        VariantStats checks[checkCount] = {
+            {"brute force rays"},
+            {"SceneQuery::rayCast"},
+            {"rayCast, batched"},
+            {"overlapSphere"},
+            {"overlapAABB"},
+        };
+        size_t runs[checkCount] = {};
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        float worldSize = 2.0f * std::cbrt(static_cast<float>(bodyCount));
+        BodyTransforms bodies;
+        for (size_t i = 0; i < bodyCount; i++)
+        {
+            bodies.positions.push_back(glm::vec3(unit(rng), unit(rng), unit(rng)) * worldSize);
+            bodies.rotations.push_back(randomRotation(rng));
+            bodies.scales.push_back(glm::vec3(1.3f + unit(rng), 1.3f + unit(rng), 1.3f + unit(rng)));
+        }
+        std::vector<OBB> boxes(bodyCount);
+        for (size_t i = 0; i < bodyCount; i++)
+            boxes[i] = makeOBB(bodies.worldFromObj(i));
+        SceneQuery sceneQuery(&pool);
+        sceneQuery.build(bodies);
+
+        const size_t rayCount = 4096;
+        std::vector<Ray> rays(rayCount);
+        for (Ray &ray : rays)
+        {
+            ray.origin = glm::vec3(unit(rng), unit(rng), unit(rng)) * worldSize * 1.2f;
+            ray.direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(1e-4f));
+            ray.maxDistance = worldSize;
+        }
+        std::vector<RayHit> hits(rayCount), batchedHits(rayCount);
+        std::vector<float> expectedDistances(rayCount);
+        measure(checks[BruteForceRays], [&]
+                {
+                    for (size_t r = 0; r < rayCount; r++)
+                    {
+                        expectedDistances[r] = FLT_MAX;
+                        for (const OBB &box : boxes)
+                            expectedDistances[r] = std::min(expectedDistances[r], rayBoxDistance(box, rays[r]));
+                    } });
+        measure(checks[Rays], [&]
+                { for (size_t r = 0; r < rayCount; r++) hits[r] = sceneQuery.rayCast(rays[r]); });
+        measure(checks[BatchedRays], [&]
+                { sceneQuery.rayCast(rays.data(), rayCount, batchedHits.data()); });
+        runs[BruteForceRays] = runs[Rays] = runs[BatchedRays] = rayCount;
+        for (size_t r = 0; r < rayCount; r++)
+        {
+            // the closest distance has to agree, the body only if no other box is hit at about the same distance
+            bool expectHit = expectedDistances[r] != FLT_MAX;
+            if (hits[r].hit != expectHit || (expectHit && glm::abs(hits[r].distance - expectedDistances[r]) > 1e-4f * (1.0f + expectedDistances[r])))
+                checks[Rays].mismatches++;
+            if (batchedHits[r].hit != hits[r].hit || batchedHits[r].body != hits[r].body || batchedHits[r].distance != hits[r].distance)
+                checks[BatchedRays].mismatches++;
+        }
+
+        std::vector<uint32_t> found, expected;
+        for (int query = 0; query < 512; query++)
+        {
+            glm::vec3 center = glm::vec3(unit(rng), unit(rng), unit(rng)) * worldSize;
+            float radius = 3.0f * (unit(rng) + 1.0f);
+            found.clear();
+            measure(checks[Spheres], [&]
+                    { sceneQuery.overlapSphere(center, radius, found); });
+            runs[Spheres]++;
+            expected.clear();
+            for (uint32_t body = 0; body < bodyCount; body++)
+            {
+                if (boxDistance(boxes[body], center) <= radius)
+                    expected.push_back(body);
+            }
+            std::sort(found.begin(), found.end());
+            checks[Spheres].mismatches += found != expected;
+
+            AABB region{center - glm::vec3(radius), center + glm::vec3(radius * 0.5f)};
+            found.clear();
+            measure(checks[Boxes], [&]
+                    { sceneQuery.overlapAABB(region, found); });
+            runs[Boxes]++;
+            expected.clear();
+            for (uint32_t body = 0; body < bodyCount; body++)
+            {
+                if (computeAABB(boxes[body]).overlaps(region))
+                    expected.push_back(body);
+            }
+            std::sort(found.begin(), found.end());
+            checks[Boxes].mismatches += found != expected;
+        }
+
+        std::cout << std::endl
+                  << bodyCount << " boxes in the SceneQuery" << std::endl;
+        return printChecks("scene queries", "us/query", checks, checkCount, runs);
+    }
+
+    ConvexShape randomShape(ShapeType type, std::mt19937 &rng, float spread)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        glm::vec3 position = (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * spread;
+        glm::quat rotation = randomRotation(rng);
+        float radius = 0.2f + 0.8f * unit(rng), halfHeight = 0.2f + 0.8f * unit(rng);
+        switch (type)
+        {
+        case ShapeType::Sphere:
+            return ConvexShape::sphere(position, radius);
+        case ShapeType::Capsule:
+            return ConvexShape::capsule(position, rotation, radius, halfHeight);
+        case ShapeType::Cylinder:
+            return ConvexShape::cylinder(position, rotation, radius, halfHeight);
+        default:
+            return ConvexShape::box(position, rotation, glm::vec3(0.1f + unit(rng), 0.1f + unit(rng), 0.1f + unit(rng)));
+        }
+    }
+
+    glm::mat4 boxMatrix(const ConvexShape &box)
+    {
+        return glm::translate(glm::mat4(1.0f), box.position) * glm::mat4_cast(box.rotation) * glm::scale(glm::mat4(1.0f), box.halfExtents * 2.0f);
+    }
+
+    // closest point of the shape to the point, the point itself inside, from the geometry of each type instead of
+    // the support function
+    glm::vec3 closestPoint(const ConvexShape &shape, glm::vec3 point)
+    {
+        glm::vec3 local = glm::conjugate(shape.rotation) * (point - shape.position);
+        switch (shape.type)
+        {
+        case ShapeType::Sphere:
+        case ShapeType::Capsule:
+        {
+            glm::vec3 onAxis(0, glm::clamp(local.y, -shape.halfExtents.y, shape.halfExtents.y), 0);
+            glm::vec3 offset = local - onAxis;
+            float length = glm::length(offset);
+            if (length > shape.radius)
+                local = onAxis + offset * (shape.radius / length);
+            break;
+        }
+        case ShapeType::Cylinder:
+        {
+            float radial = glm::length(glm::vec2(local.x, local.z));
+            if (radial > shape.radius)
+            {
+                local.x *= shape.radius / radial;
+                local.z *= shape.radius / radial;
+            }
+            local.y = glm::clamp(local.y, -shape.halfExtents.y, shape.halfExtents.y);
+            break;
+        }
+        default:
+            local = glm::clamp(local, -shape.halfExtents, shape.halfExtents);
+            break;
+        }
+        return shape.position + shape.rotation * local;
+    }
+
+    float shapeDistance(const ConvexShape &shape, glm::vec3 point)
+    {
+        return glm::length(point - closestPoint(shape, point));
+    }
+
+    // distance of the shapes by projecting onto one shape and the other in turn, which approaches the distance of any
+    // two convex shapes from above, slowly where their surfaces are almost parallel
+    float projectedDistance(const ConvexShape &a, const ConvexShape &b)
+    {
+        glm::vec3 pointB = closestPoint(b, a.position);
+        glm::vec3 pointA = closestPoint(a, pointB);
+        float distance = glm::length(pointA - pointB);
+        for (int i = 0; i < 100000 && distance > 0; i++)
+        {
+            pointB = closestPoint(b, pointA);
+            pointA = closestPoint(a, pointB);
+            float next = glm::length(pointA - pointB);
+            if (!(next < distance))
+                return std::min(distance, next);
+            distance = next;
+        }
+        return distance;
+    }
+
+    // distance of the axis segments of two spheres or capsules, in double precision, as a golden section search along
+    // the first segment with the closest point of the second one, which is convex along the first
+    double segmentDistance(const ConvexShape &a, const ConvexShape &b)
+    {
+        glm::dvec3 axisA = glm::dquat(a.rotation) * glm::dvec3(0, a.halfExtents.y, 0);
+        glm::dvec3 axisB = glm::dquat(b.rotation) * glm::dvec3(0, b.halfExtents.y, 0);
+        glm::dvec3 centerA(a.position), centerB(b.position);
+        double lengthSquared = glm::dot(axisB, axisB);
+        auto distanceAt = [&](double s)
+        {
+            glm::dvec3 point = centerA + axisA * s;
+            double t = lengthSquared > 0 ? glm::clamp(glm::dot(point - centerB, axisB) / lengthSquared, -1.0, 1.0) : 0.0;
+            return glm::length(point - (centerB + axisB * t));
+        };
+        const double ratio = 0.5 * (std::sqrt(5.0) - 1);
+        double low = -1, high = 1;
+        for (int i = 0; i < 80; i++)
+        {
+            double s1 = high - ratio * (high - low), s2 = low + ratio * (high - low);
+            if (distanceAt(s1) < distanceAt(s2))
+                high = s2;
+            else
+                low = s1;
+        }
+        return std::min({distanceAt(-1), distanceAt(1), distanceAt(0.5 * (low + high))});
+    }
+
+    // exact penetration depth of spheres and capsules, which are points and segments grown by the radius, and of
+    // spheres and boxes, negative if they are apart
+    float exactSweptDepth(const ConvexShape &a, const ConvexShape &b)
+    {
+        if (a.type == ShapeType::Box || b.type == ShapeType::Box)
+        {
+            const ConvexShape &box = a.type == ShapeType::Box ? a : b, &sphere = a.type == ShapeType::Box ? b : a;
+            glm::vec3 local = glm::abs(glm::conjugate(box.rotation) * (sphere.position - box.position));
+            glm::vec3 inside = box.halfExtents - local;
+            float faceDistance = std::min({inside.x, inside.y, inside.z});
+            return sphere.radius + (faceDistance > 0 ? faceDistance : -shapeDistance(box, sphere.position));
+        }
+        return static_cast<float>(a.radius + b.radius - segmentDistance(a, b));
+    }
+
+    // lowest point of the shape along the direction, also from the geometry of each type
+    float lowestAlong(const ConvexShape &shape, glm::vec3 direction)
+    {
+        glm::vec3 local = glm::conjugate(shape.rotation) * direction;
+        float center = glm::dot(direction, shape.position);
+        switch (shape.type)
+        {
+        case ShapeType::Sphere:
+            return center - shape.radius;
+        case ShapeType::Capsule:
+            return center - glm::abs(local.y) * shape.halfExtents.y - shape.radius;
+        case ShapeType::Cylinder:
+            return center - glm::abs(local.y) * shape.halfExtents.y - glm::length(glm::vec2(local.x, local.z)) * shape.radius;
+        default:
+            return center - glm::dot(glm::abs(local), shape.halfExtents);
+        }
+    }
+
+    // overlap of the shapes along the direction from A to B, negative if it separates them
+    float overlapAlong(const ConvexShape &a, const ConvexShape &b, glm::vec3 direction)
+    {
+        return -lowestAlong(a, -direction) - lowestAlong(b, direction);
+    }
+
+    // exact penetration depth of two boxes, the smallest overlap along the face normals and edge cross products,
+    // negative if one of the axes separates them
+    float exactBoxDepth(const ConvexShape &a, const ConvexShape &b)
+    {
+        glm::vec3 axes[15];
+        for (int i = 0; i < 3; i++)
+        {
+            axes[i] = a.rotation * glm::vec3(i == 0, i == 1, i == 2);
+            axes[3 + i] = b.rotation * glm::vec3(i == 0, i == 1, i == 2);
+        }
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                axes[6 + 3 * i + j] = glm::cross(axes[i], axes[3 + j]);
+        float depth = FLT_MAX;
+        for (glm::vec3 axis : axes)
+        {
+            float length = glm::length(axis);
+            // parallel edges, their cross product is covered by the face normals
+            if (length < 1e-4f)
+                continue;
+            axis /= length;
+            depth = std::min(depth, std::min(overlapAlong(a, b, axis), overlapAlong(a, b, -axis)));
+        }
+        return depth;
+    }
+
+    // compares GJK and EPA, the collision kernels and the continuous collision detection with references built from
+    // the geometry of the shapes and with checkCollisionSAT, none of them uses the support function iterations
+    bool checkConvexShapes(size_t pairCount, unsigned seed)
+    {
+        enum Check
+        {
+            Distance,
+            Penetration,
+            BoxKernel,
+            CurvedKernels,
+            PlaneKernels,
+            TimeOfImpact,
+            BulletClamping,
+            checkCount
+        };
+        VariantStats checks[checkCount] = {
+            {"gjkDistance"},
+            {"epaPenetration, boxes"},
+            {"box-box kernel"},
+            {"sphere, capsule kernels"},
+            {"plane kernels"},
+            {"timeOfImpact"},
+            {"clampBulletMotion"},
+        };
+        size_t runs[checkCount] = {};
+        const float tolerance = 1e-4f;
+        auto differs = [&](float value, float expected)
+        { return !(glm::abs(value - expected) <= tolerance * (1.0f + glm::abs(expected))); };
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        const ShapeType boundedTypes[] = {ShapeType::Sphere, ShapeType::Capsule, ShapeType::Cylinder, ShapeType::Box};
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ConvexShape a = randomShape(boundedTypes[rng() % 4], rng, 4.0f);
+            ConvexShape b = randomShape(boundedTypes[rng() % 4], rng, 4.0f);
+            GJKResult gjk;
+            measure(checks[Distance], [&]
+                    { gjk = gjkDistance(a, b); });
+            runs[Distance]++;
+            if (gjk.intersecting)
+                continue;
+            // the closest points have to lie on the shapes and be no farther apart than the projections get
+            float reference = projectedDistance(a, b);
+            if (differs(gjk.distance, glm::length(gjk.pointB - gjk.pointA)) || gjk.distance > reference + tolerance * (1.0f + reference) ||
+                shapeDistance(a, gjk.pointA) > tolerance || shapeDistance(b, gjk.pointB) > tolerance)
+                checks[Distance].mismatches++;
+        }
+
+        // the box-box kernel runs checkCollisionSAT, whose depth is not always the smallest overlap, see CollisionKernels.h
+        float largestSATDeficit = 0;
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ConvexShape a = randomShape(ShapeType::Box, rng, 2.0f);
+            ConvexShape b = randomShape(ShapeType::Box, rng, 2.0f);
+            // deep containment of a small box
+            if (i % 4 == 0)
+            {
+                b.halfExtents *= 0.3f;
+                b.position = a.position + a.rotation * ((glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * a.halfExtents);
+            }
+            float exact = exactBoxDepth(a, b);
+            GJKResult gjk;
+            EPAResult epa;
+            measure(checks[Penetration], [&]
+                    {
+                        gjk = gjkDistance(a, b);
+                        if (gjk.intersecting)
+                            epa = epaPenetration(a, b, gjk.simplex); });
+            runs[Penetration]++;
+            // too close to touching to tell
+            if (glm::abs(exact) > tolerance)
+            {
+                bool overlapping = exact > 0;
+                if (gjk.intersecting != overlapping || (overlapping && (!epa.valid || differs(epa.depth, exact))))
+                    checks[Penetration].mismatches++;
+            }
+
+            CollisionInfo kernel;
+            measure(checks[BoxKernel], [&]
+                    { kernel = checkCollision(a, b); });
+            runs[BoxKernel]++;
+            if (!sameResult(kernel, checkCollisionSAT(boxMatrix(a), boxMatrix(b))))
+                checks[BoxKernel].mismatches++;
+            if (kernel.isColliding && exact > 0)
+                largestSATDeficit = std::max(largestSATDeficit, exact - kernel.depth);
+        }
+
+        // every pair of spheres, capsules and boxes with a kernel of its own, in both orders
+        const ShapeType curvedPairs[][2] = {
+            {ShapeType::Sphere, ShapeType::Sphere},
+            {ShapeType::Sphere, ShapeType::Box},
+            {ShapeType::Box, ShapeType::Sphere},
+            {ShapeType::Sphere, ShapeType::Capsule},
+            {ShapeType::Capsule, ShapeType::Sphere},
+            {ShapeType::Capsule, ShapeType::Capsule},
+        };
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            const ShapeType *types = curvedPairs[i % 6];
+            ConvexShape a = randomShape(types[0], rng, 2.0f);
+            ConvexShape b = randomShape(types[1], rng, 2.0f);
+            CollisionInfo kernel;
+            measure(checks[CurvedKernels], [&]
+                    { kernel = checkCollision(a, b); });
+            runs[CurvedKernels]++;
+            float exact = exactSweptDepth(a, b);
+            // too close to touching to tell
+            if (glm::abs(exact) <= tolerance)
+                continue;
+            // the depth also has to be the overlap along the normal
+            if (kernel.isColliding != (exact > 0) ||
+                (kernel.isColliding && (differs(kernel.depth, exact) || differs(kernel.depth, overlapAlong(a, b, -kernel.normalWorld)))))
+                checks[CurvedKernels].mismatches++;
+        }
+
+        // every bounded shape against a plane, with the plane first in half of them
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ConvexShape shape = randomShape(boundedTypes[i % 4], rng, 2.0f);
+            glm::vec3 normal = randomRotation(rng) * glm::vec3(0, 1, 0);
+            ConvexShape plane = ConvexShape::plane(normal, (unit(rng) - 0.5f) * 2.0f);
+            bool planeFirst = (i / 4) % 2 == 1;
+            CollisionInfo kernel;
+            measure(checks[PlaneKernels], [&]
+                    { kernel = planeFirst ? checkCollision(plane, shape) : checkCollision(shape, plane); });
+            runs[PlaneKernels]++;
+            float depth = plane.planeOffset() - lowestAlong(shape, normal);
+            if (glm::abs(depth) <= tolerance)
+                continue;
+            glm::vec3 expectedNormal = planeFirst ? -normal : normal;
+            if (kernel.isColliding != (depth > 0) ||
+                (kernel.isColliding && (differs(kernel.depth, depth) || glm::dot(kernel.normalWorld, expectedNormal) < 0.9999f)))
+                checks[PlaneKernels].mismatches++;
+        }
+
+        // boxes moving and turning through each other, compared with checkCollisionSAT at many points of the step
+        const int samples = 256;
+        const float toiTolerance = 0.001f;
+        size_t toiPairs = pairCount / 16;
+        for (size_t i = 0; i < toiPairs; i++)
+        {
+            BodyTransforms start, end;
+            for (int body = 0; body < 2; body++)
+            {
+                glm::vec3 position = (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * 6.0f;
+                glm::quat rotation = randomRotation(rng);
+                glm::vec3 scale(0.1f + unit(rng), 0.1f + unit(rng), 0.1f + unit(rng));
+                start.positions.push_back(position);
+                start.rotations.push_back(rotation);
+                start.scales.push_back(scale);
+                end.positions.push_back(position + (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * 8.0f);
+                end.rotations.push_back(glm::normalize(rotation * glm::angleAxis(3.0f * unit(rng), randomRotation(rng) * glm::vec3(0, 0, 1))));
+                end.scales.push_back(scale);
+            }
+            auto poseAt = [&](uint32_t body, float t, float grow)
+            {
+                return glm::translate(glm::mat4(1.0f), glm::mix(start.positions[body], end.positions[body], t)) *
+                       glm::mat4_cast(glm::slerp(start.rotations[body], end.rotations[body], t)) *
+                       glm::scale(glm::mat4(1.0f), start.scales[body] + 2.0f * grow);
+            };
+            TOIResult toi;
+            measure(checks[TimeOfImpact], [&]
+                    { toi = timeOfImpact(start, end, 0, 1, toiTolerance); });
+            runs[TimeOfImpact]++;
+            float firstContact = 1;
+            for (int s = 0; s <= samples; s++)
+            {
+                float t = float(s) / samples;
+                if (checkCollisionSAT(poseAt(0, t, 0), poseAt(1, t, 0)).isColliding)
+                {
+                    firstContact = t;
+                    break;
+                }
+            }
+            // the time of impact must not be after any sampled contact, and the boxes have to be within the
+            // tolerance there unless the iterations ran out
+            bool missed = firstContact < 1 && (!toi.hit || toi.time > firstContact);
+            bool early = toi.hit && !toi.initiallyOverlapping && toi.iterations < 32 &&
+                         !checkCollisionSAT(poseAt(0, toi.time, toiTolerance), poseAt(1, toi.time, toiTolerance)).isColliding;
+            if (missed || early)
+                checks[TimeOfImpact].mismatches++;
+        }
+
+        // small fast bullets shot through thin walls, which they would pass between two steps
+        const uint32_t wallCount = 8, bulletCount = static_cast<uint32_t>(std::max<size_t>(pairCount / 64, 1));
+        BodyTransforms start, end;
+        std::vector<uint8_t> isBullet;
+        for (uint32_t wall = 0; wall < wallCount; wall++)
+        {
+            glm::vec3 position(2.0f + 2.0f * wall, 0, 0);
+            glm::quat rotation = glm::angleAxis(0.3f * (unit(rng) - 0.5f), glm::vec3(0, 1, 0));
+            for (BodyTransforms *pose : {&start, &end})
+            {
+                pose->positions.push_back(position);
+                pose->rotations.push_back(rotation);
+                pose->scales.push_back(glm::vec3(0.05f, 4.0f, 4.0f));
+            }
+            isBullet.push_back(0);
+        }
+        for (uint32_t bullet = 0; bullet < bulletCount; bullet++)
+        {
+            glm::vec3 position(-unit(rng), 3.0f * (unit(rng) - 0.5f), 3.0f * (unit(rng) - 0.5f));
+            glm::quat rotation = randomRotation(rng);
+            glm::vec3 scale = glm::vec3(0.05f + 0.1f * unit(rng));
+            start.positions.push_back(position);
+            start.rotations.push_back(rotation);
+            start.scales.push_back(scale);
+            end.positions.push_back(position + glm::vec3(5.0f + 15.0f * unit(rng), unit(rng) - 0.5f, unit(rng) - 0.5f));
+            end.rotations.push_back(glm::normalize(rotation * glm::angleAxis(6.0f * unit(rng), glm::vec3(1, 0, 0))));
+            end.scales.push_back(scale);
+            isBullet.push_back(1);
+        }
+        // every eighth bullet rests against the first wall instead, a little closer than the tolerance, and moves off or
+        // slides along it without turning, nothing may stop those
+        std::vector<uint8_t> resting(wallCount + bulletCount, 0);
+        for (uint32_t bullet = wallCount; bullet < wallCount + bulletCount; bullet += 8)
+        {
+            glm::quat rotation = start.rotations[0];
+            glm::vec3 outward = rotation * glm::vec3(-1, 0, 0), along = rotation * glm::vec3(0, 1, 0);
+            float size = start.scales[bullet].x;
+            glm::vec3 position = start.positions[0] + outward * (0.025f + 0.5f * size + 0.5f * toiTolerance) + along * (3.0f * (unit(rng) - 0.5f));
+            start.positions[bullet] = position;
+            start.rotations[bullet] = end.rotations[bullet] = rotation;
+            end.positions[bullet] = position + outward * (bullet % 16 == 0 ? 0.0f : 5.0f * unit(rng)) + along * (unit(rng) - 0.5f);
+            resting[bullet] = 1;
+        }
+        std::vector<BodyPair> bulletPairs;
+        for (uint32_t bullet = wallCount; bullet < wallCount + bulletCount; bullet++)
+            for (uint32_t wall = 0; wall < wallCount; wall++)
+                bulletPairs.push_back({wall, bullet});
+        BodyTransforms clamped = end;
+        measure(checks[BulletClamping], [&]
+                { clampBulletMotion(start, clamped, isBullet, bulletPairs.data(), bulletPairs.size(), toiTolerance); });
+        runs[BulletClamping] = bulletCount;
+        size_t tunnelling = 0;
+        for (uint32_t bullet = wallCount; bullet < wallCount + bulletCount; bullet++)
+        {
+            float travel = glm::length(end.positions[bullet] - start.positions[bullet]);
+            float clampedTravel = glm::length(clamped.positions[bullet] - start.positions[bullet]);
+            // sampled finely enough that the bullets cannot skip a wall in between
+            float firstContact = 1;
+            for (int s = 0; s <= samples * 4 && firstContact == 1; s++)
+            {
+                float t = float(s) / (samples * 4);
+                glm::mat4 pose = glm::translate(glm::mat4(1.0f), glm::mix(start.positions[bullet], end.positions[bullet], t)) *
+                                 glm::mat4_cast(glm::slerp(start.rotations[bullet], end.rotations[bullet], t)) *
+                                 glm::scale(glm::mat4(1.0f), start.scales[bullet]);
+                for (uint32_t wall = 0; wall < wallCount; wall++)
+                {
+                    if (checkCollisionSAT(pose, start.worldFromObj(wall)).isColliding)
+                    {
+                        firstContact = t;
+                        break;
+                    }
+                }
+            }
+            bool overlapsWall = false, endOverlapsWall = false;
+            for (uint32_t wall = 0; wall < wallCount; wall++)
+            {
+                overlapsWall |= checkCollisionSAT(clamped.worldFromObj(bullet), clamped.worldFromObj(wall)).isColliding;
+                endOverlapsWall |= checkCollisionSAT(end.worldFromObj(bullet), end.worldFromObj(wall)).isColliding;
+            }
+            if (firstContact < 1 && !endOverlapsWall)
+                tunnelling++;
+            if (overlapsWall || clampedTravel > travel * firstContact + 1e-4f || (resting[bullet] && clamped.positions[bullet] != end.positions[bullet]))
+                checks[BulletClamping].mismatches++;
+        }
+
+        std::cout << std::endl
+                  << pairCount << " shape pairs, " << toiPairs << " moving box pairs, " << bulletCount << " bullets, "
+                  << tunnelling << " of them passing a wall without clamping, " << (bulletCount + 7) / 8 << " resting on one" << std::endl
+                  << "box-box kernel depth up to " << std::setprecision(3) << largestSATDeficit << " below the exact depth" << std::endl;
+        return printChecks("convex shapes", "us/pair", checks, checkCount, runs);
+    }
+
+    // the manifolds of box pairs stepped through a ContactCache, the impulses have to follow the feature ids from
+    // step to step, also when the pair comes the other way round, and the pairs have to live through maxAge missed steps
+    bool checkContactCache(size_t pairCount, unsigned seed)
+    {
+        enum Check
+        {
+            SameOrder,
+            OtherOrder,
+            Aging,
+            checkCount
+        };
+        VariantStats checks[checkCount] = {
+            {"ContactCache, same order"},
+            {"ContactCache, other order"},
+            {"ContactCache, aging"},
+        };
+        size_t runs[checkCount] = {};
+
+        std::mt19937 rng(seed);
+        BodyTransforms bodies;
+        for (size_t i = 0; i < pairCount; i++)
+            addPair(i % 2 ? Touching : Overlapping, rng, bodies);
+        std::vector<ContactManifold> forward(pairCount), backward(pairCount);
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            OBB box_A = makeOBB(bodies.worldFromObj(2 * i));
+            OBB box_B = makeOBB(bodies.worldFromObj(2 * i + 1));
+            forward[i] = checkCollisionSATManifold(box_A, box_B);
+            backward[i] = checkCollisionSATManifold(box_B, box_A);
+        }
+        // what the solver writes back for point j of forward[i], different for every point so a wrong match shows
+        auto normalImpulse = [](size_t i, int j) { return float(i * ContactManifold::maxPoints + j + 1); };
+        auto tangentImpulse = [](size_t i, int j) { return glm::vec3(float(i), float(j), 1.0f); };
+        auto pairOf = [](size_t i) { return BodyPair{uint32_t(2 * i), uint32_t(2 * i + 1)}; };
+
+        ContactCache cache;
+        size_t colliding = 0;
+        cache.beginStep();
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ContactCache::PairContacts *entry = cache.update(pairOf(i), forward[i]);
+            if (!entry)
+                continue;
+            colliding++;
+            for (int j = 0; j < forward[i].pointCount; j++)
+            {
+                if (entry->normalImpulses[j] != 0 || entry->tangentImpulses[j] != glm::vec3(0))
+                    checks[SameOrder].mismatches++;
+                entry->normalImpulses[j] = normalImpulse(i, j);
+                entry->tangentImpulses[j] = tangentImpulse(i, j);
+            }
+        }
+
+        // the same manifolds with the points in reverse order, each point keeps the impulses of its feature id
+        std::vector<ContactManifold> reversed = forward;
+        for (ContactManifold &manifold : reversed)
+            std::reverse(manifold.points, manifold.points + manifold.pointCount);
+        cache.beginStep();
+        measure(checks[SameOrder], [&]
+                { for (size_t i = 0; i < pairCount; i++) cache.update(pairOf(i), reversed[i]); });
+        runs[SameOrder] = colliding;
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ContactCache::PairContacts *entry = cache.find(pairOf(i));
+            if (!forward[i].isColliding)
+            {
+                checks[SameOrder].mismatches += entry != nullptr;
+                continue;
+            }
+            int n = forward[i].pointCount;
+            for (int k = 0; k < n && entry; k++)
+            {
+                if (entry->normalImpulses[k] != normalImpulse(i, n - 1 - k) || entry->tangentImpulses[k] != tangentImpulse(i, n - 1 - k))
+                    checks[SameOrder].mismatches++;
+            }
+            checks[SameOrder].mismatches += entry == nullptr;
+        }
+
+        // the broadphase reports (b, a), the pairs keep their entry and the points of the same features their impulses,
+        // the tangent impulse turned to act on the other body
+        cache.beginStep();
+        measure(checks[OtherOrder], [&]
+                { for (size_t i = 0; i < pairCount; i++) cache.update({pairOf(i).b, pairOf(i).a}, backward[i]); });
+        runs[OtherOrder] = colliding;
+        size_t otherOrderPoints = 0, otherOrderWarmStarted = cache.warmStartedPoints;
+        if (cache.size() != colliding)
+            checks[OtherOrder].mismatches++;
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ContactCache::PairContacts *entry = cache.find(pairOf(i));
+            if (!backward[i].isColliding || !entry || entry->pair.a != pairOf(i).b)
+            {
+                checks[OtherOrder].mismatches += backward[i].isColliding != forward[i].isColliding || (backward[i].isColliding && !entry) ||
+                                                  (entry && entry->pair.a != pairOf(i).b);
+                continue;
+            }
+            otherOrderPoints += backward[i].pointCount;
+            for (int k = 0; k < backward[i].pointCount; k++)
+            {
+                float expectedNormal = 0;
+                glm::vec3 expectedTangent(0);
+                for (int j = 0; j < forward[i].pointCount; j++)
+                {
+                    if (swappedFeatureId(forward[i].points[j].featureId) == backward[i].points[k].featureId)
+                    {
+                        expectedNormal = normalImpulse(i, j);
+                        expectedTangent = -tangentImpulse(i, j);
+                    }
+                }
+                if (entry->normalImpulses[k] != expectedNormal || entry->tangentImpulses[k] != expectedTangent)
+                    checks[OtherOrder].mismatches++;
+            }
+        }
+
+        // every pair misses maxAge steps and is still there in the step after them, where the odd ones touch again
+        // and keep their impulses, the even ones are evicted on the next beginStep
+        runs[Aging] = colliding;
+        for (uint32_t step = 0; step <= cache.maxAge; step++)
+            measure(checks[Aging], [&]
+                    { cache.beginStep(); });
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ContactCache::PairContacts *entry = cache.find(pairOf(i));
+            if (!backward[i].isColliding)
+                continue;
+            if (!entry || entry->age != cache.maxAge + 1)
+            {
+                checks[Aging].mismatches++;
+                continue;
+            }
+            if (i % 2 == 0)
+                continue;
+            std::vector<float> impulses(entry->normalImpulses, entry->normalImpulses + entry->manifold.pointCount);
+            entry = cache.update({pairOf(i).b, pairOf(i).a}, backward[i]);
+            if (!std::equal(impulses.begin(), impulses.end(), entry->normalImpulses))
+                checks[Aging].mismatches++;
+        }
+        measure(checks[Aging], [&]
+                { cache.beginStep(); });
+        size_t kept = 0;
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            ContactCache::PairContacts *entry = cache.find(pairOf(i));
+            bool expected = backward[i].isColliding && i % 2 == 1;
+            kept += expected;
+            if ((entry != nullptr) != expected || (entry && (entry->age != 1 || entry->pair.a != pairOf(i).b)))
+                checks[Aging].mismatches++;
+        }
+        if (cache.size() != kept)
+            checks[Aging].mismatches++;
+
+        std::cout << std::endl
+                  << colliding << " touching box pairs in the contact cache, " << otherOrderWarmStarted << " of "
+                  << otherOrderPoints << " points warm started with the pairs the other way round" << std::endl;
+        return printChecks("contact cache", "us/pair", checks, checkCount, runs);
+    }
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: CollisionBench [options]\n"
+                 "  --pairs <n>    Number of random box pairs. Default: 2097152\n"
+                 "  --bodies <n>   Number of bodies in the broadphases and scene queries. Default: 2000\n"
+                 "  --steps <n>    Steps of moving, removing and adding bodies in the broadphases. Default: 50\n"
+                 "  --shapes <n>   Number of random pairs for GJK, EPA, the collision kernels and the contact cache. Default: 60000\n"
+                 "  --threads <n>  Threads of the pool used by the batches. Default: one per hardware thread\n"
+                 "  --seed <n>     Seed of the random pairs. Default: 1\n"
+                 "  --help         Print this message\n"
+                 "The exit code is 1 if any check fails and 2 for invalid arguments."
+              << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t pairCount = 2 << 20;
+    size_t bodyCount = 2000;
+    size_t steps = 50;
+    size_t shapePairCount = 60000;
+    size_t threadCount = 0;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        // the only flag without a value
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for argument " << arg << std::endl;
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        try
+        {
+            if (arg == "--pairs")
+                pairCount = std::stoul(value);
+            else if (arg == "--bodies")
+                bodyCount = std::stoul(value);
+            else if (arg == "--steps")
+                steps = std::stoul(value);
+            else if (arg == "--shapes")
+                shapePairCount = std::stoul(value);
+            else if (arg == "--threads")
+                threadCount = std::stoul(value);
+            else if (arg == "--seed")
+                seed = (unsigned)std::stoul(value);
+            else
+            {
+                std::cerr << "Unknown argument " << arg << std::endl;
+                printUsage();
+                return 2;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid value for argument " << arg << ": " << value << std::endl;
+            return 2;
+        }
+    }
+
+    bool passed = checkReferenceCases();
+
+    enum Variant
+    {
+        Reference,
+        Matrix,
+        Boxes,
+        AxisCache,
+        Batch,
+        BatchAxisCache,
+        Manifold,
+        BatchManifold,
+        variantCount
+    };
+    VariantStats stats[variantCount] = {
+        {"reference (std::vector)"},
+        {"checkCollisionSAT(mat4)"},
+        {"checkCollisionSAT(OBB)"},
+        {"OBB + axis cache, warm"},
+        {"BatchNarrowphase"},
+        {"BatchNarrowphase + cache"},
+        {"checkCollisionSATManifold"},
+        {"BatchNarrowphase manifold"},
+    };
+    size_t kindPairs[pairKindCount] = {}, kindColliding[pairKindCount] = {}, kindMismatches[pairKindCount] = {};
+
+    // pairs are tested in chunks, so millions of them fit in memory and the caches see the same pairs twice
+    const size_t chunkSize = 1 << 16;
+    std::mt19937 rng(seed);
+    ThreadPool pool(threadCount);
+    BatchNarrowphase batch(&pool);
+    BatchNarrowphase cachedBatch(&pool);
+    cachedBatch.useAxisCache = true;
+
+    BodyTransforms bodies;
+    std::vector<BodyPair> pairs;
+    std::vector<PairKind> kinds;
+    std::vector<glm::mat4> matrices;
+    std::vector<OBB> boxes;
+    std::vector<SeparatingAxisCache> axisCaches;
+    std::vector<CollisionInfo> reference(chunkSize), results(chunkSize);
+    std::vector<ContactManifold> manifolds(chunkSize), batchManifolds(chunkSize);
+
+    auto compare = [&](Variant variant, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (sameResult(results[i], reference[i]))
+                continue;
+            if (stats[variant].mismatches++ == 0)
+                std::cerr << stats[variant].name << " differs from the reference for a " << pairKindNames[kinds[i]] << " pair" << std::endl;
+            kindMismatches[kinds[i]]++;
+        }
+    };
+
+    for (size_t first = 0; first < pairCount; first += chunkSize)
+    {
+        size_t count = std::min(chunkSize, pairCount - first);
+        bodies.positions.clear();
+        bodies.rotations.clear();
+        bodies.scales.clear();
+        pairs.resize(count);
+        kinds.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            kinds[i] = PairKind((first + i) % pairKindCount);
+            addPair(kinds[i], rng, bodies);
+            pairs[i] = {uint32_t(2 * i), uint32_t(2 * i + 1)};
+        }
+        matrices.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++)
+            matrices[i] = bodies.worldFromObj(i);
+
+        measure(stats[Reference], [&]
+                { for (size_t i = 0; i < count; i++) reference[i] = referenceSAT(matrices[2 * i], matrices[2 * i + 1]); });
+        for (size_t i = 0; i < count; i++)
+        {
+            kindPairs[kinds[i]]++;
+            kindColliding[kinds[i]] += reference[i].isColliding;
+        }
+
+        measure(stats[Matrix], [&]
+                { for (size_t i = 0; i < count; i++) results[i] = checkCollisionSAT(matrices[2 * i], matrices[2 * i + 1]); });
+        compare(Matrix, count);
+
+        // makeOBB is done once per body and step in a simulation, so it is not part of the pair time
+        boxes.resize(bodies.size());
+        for (size_t i = 0; i < bodies.size(); i++)
+            boxes[i] = makeOBB(matrices[i]);
+        measure(stats[Boxes], [&]
+                { for (size_t i = 0; i < count; i++) results[i] = checkCollisionSAT(boxes[2 * i], boxes[2 * i + 1]); });
+        compare(Boxes, count);
+
+        // the cold run fills the caches, the warm run is the one of the next step for pairs that did not move
+        axisCaches.assign(count, SeparatingAxisCache());
+        for (size_t i = 0; i < count; i++)
+            results[i] = checkCollisionSAT(boxes[2 * i], boxes[2 * i + 1], &axisCaches[i]);
+        compare(AxisCache, count);
+        measure(stats[AxisCache], [&]
+                { for (size_t i = 0; i < count; i++) results[i] = checkCollisionSAT(boxes[2 * i], boxes[2 * i + 1], &axisCaches[i]); });
+        compare(AxisCache, count);
+
+        // the batches include building their boxes
+        measure(stats[Batch], [&]
+                { batch.run(bodies, pairs.data(), count, results.data()); });
+        compare(Batch, count);
+
+        cachedBatch.run(bodies, pairs.data(), count, results.data());
+        compare(BatchAxisCache, count);
+        measure(stats[BatchAxisCache], [&]
+                { cachedBatch.run(bodies, pairs.data(), count, results.data()); });
+        compare(BatchAxisCache, count);
+
+        measure(stats[Manifold], [&]
+                { for (size_t i = 0; i < count; i++) manifolds[i] = checkCollisionSATManifold(boxes[2 * i], boxes[2 * i + 1]); });
+        for (size_t i = 0; i < count; i++)
+        {
+            if (manifoldMatches(manifolds[i], reference[i], boxes[2 * i], boxes[2 * i + 1]))
+                continue;
+            if (stats[Manifold].mismatches++ == 0)
+                std::cerr << stats[Manifold].name << " differs from the reference for a " << pairKindNames[kinds[i]] << " pair" << std::endl;
+            kindMismatches[kinds[i]]++;
+        }
+
+        measure(stats[BatchManifold], [&]
+                { batch.run(bodies, pairs.data(), count, batchManifolds.data()); });
+        for (size_t i = 0; i < count; i++)
+        {
+            if (sameManifold(batchManifolds[i], manifolds[i]))
+                continue;
+            if (stats[BatchManifold].mismatches++ == 0)
+                std::cerr << stats[BatchManifold].name << " differs from checkCollisionSATManifold for a " << pairKindNames[kinds[i]] << " pair" << std::endl;
+            kindMismatches[kinds[i]]++;
+        }
+    }
+
+    std::cout << std::endl
+              << pairCount << " pairs, " << pool.threadCount() << " threads for the batches" << std::endl;
+    for (int kind = 0; kind < pairKindCount; kind++)
+        std::cout << std::setw(12) << pairKindNames[kind] << ": " << kindPairs[kind] << " pairs, " << kindColliding[kind]
+                  << " colliding, " << kindMismatches[kind] << " mismatches" << std::endl;
+
+    std::cout << std::endl
+              << std::left << std::setw(28) << "variant" << std::right << std::setw(12) << "ns/pair" << std::setw(16) << "allocs/pair"
+              << std::setw(12) << "mismatches" << std::endl;
+    size_t divisor = std::max<size_t>(pairCount, 1);
+    for (auto &variant : stats)
+    {
+        std::cout << std::left << std::setw(28) << variant.name << std::right << std::fixed
+                  << std::setw(12) << std::setprecision(1) << variant.nanoseconds / divisor
+                  << std::setw(16) << std::setprecision(3) << double(variant.allocations) / divisor
+                  << std::setw(12) << variant.mismatches << std::endl;
+        if (variant.mismatches > 0)
+            passed = false;
+    }
+
+    if (!checkBroadphases(bodyCount, steps, seed, pool))
+        passed = false;
+    if (!checkSceneQueries(bodyCount, seed, pool))
+        passed = false;
+    if (!checkConvexShapes(shapePairCount, seed))
+        passed = false;
+    if (!checkContactCache(shapePairCount, seed))
+        passed = false;
+
+    std::cout << std::endl
+              << (passed ? "all checks passed" : "CHECKS FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+#include "HeadlessSimulator.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include "Scenes/SceneIndex.h"
+#include <util/TimingHistory.h>
+#include <util/ThreadPool.h>
+#include <imgui.h>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <stdexcept>
+
+bool HeadlessSimulator::parseArguments(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+            continue;
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for argument " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        try
+        {
+            if (arg == "--scene")
+                sceneNames.push_back(value);
+            else if (arg == "--steps")
+                steps = parseCount(value);
+            else if (arg == "--warmup")
+                warmupSteps = parseCount(value);
+            else if (arg == "--rate")
+                physicsRate = std::stof(value);
+            else if (arg == "--load-state")
+                loadStatePath = value;
+            else if (arg == "--save-state")
+                saveStatePath = value;
+            else if (arg == "--replay")
+                replayPath = value;
+            else if (arg == "--param")
+            {
+                if (!parseParameter(value))
+                    return false;
+                batch = true;
+            }
+            else if (arg == "--repeat")
+            {
+                repeats = std::max<size_t>(parseCount(value), 1);
+                batch = true;
+            }
+            else if (arg == "--threads")
+                threadCount = parseCount(value);
+            else if (arg == "--csv")
+                csvPath = value;
+            else
+            {
+                std::cerr << "Unknown argument " << arg << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Invalid value for argument " << arg << ": " << value << std::endl;
+            return false;
+        }
+    }
+    if (!(physicsRate > 0))
+    {
+        std::cerr << "Physics rate has to be positive" << std::endl;
+        return false;
+    }
+    for (auto &sceneName : sceneNames)
+    {
+        if (scenesCreators.find(sceneName) == scenesCreators.end())
+        {
+            std::cerr << "Unknown scene \"" << sceneName << "\"" << std::endl;
+            return false;
+        }
+    }
+    if (sceneNames.empty())
+    {
+        for (auto &scene : scenesCreators)
+            sceneNames.push_back(scene.first);
+    }
+    return true;
+}
+
+void HeadlessSimulator::printUsage()
+{
+    std::cerr << "Usage: Template --headless [options]\n"
+                 "  --scene <name>           Scene to run, can be given multiple times. Default: all scenes\n"
+                 "  --steps <n>              Number of timed simulateStep calls. Default: 1000\n"
+                 "  --warmup <n>             Number of untimed simulateStep calls before measuring. Default: 10\n"
+                 "  --rate <hz>              Physics rate. Default: 60\n"
+                 "  --load-state <file>      Start from a snapshot written by --save-state\n"
+                 "  --save-state <file>      Write a snapshot after the last step\n"
+                 "  --param <name>=<values>  Sweep a scene parameter over a list 1,2,4 or a range from:to:step\n"
+                 "  --repeat <n>             Run every combination of the swept parameters n times. Default: 1\n"
+                 "  --threads <n>            Scene instances stepped concurrently in a batch. Default: one per hardware thread\n"
+                 "  --csv <file>             Also write the batch results to a CSV file\n"
+                 "  --replay <file>          Replay a recorded session and compare the state after every frame"
+              << std::endl;
+}
+
+size_t HeadlessSimulator::parseCount(const std::string &value)
+{
+    // std::stoul skips leading whitespace and accepts a sign, "-5" would become a huge count
+    size_t first = value.find_first_not_of(" \t\n\v\f\r");
+    if (first != std::string::npos && value[first] == '-')
+        throw std::invalid_argument(value);
+    size_t end = 0;
+    unsigned long count = std::stoul(value, &end);
+    if (end != value.size())
+        throw std::invalid_argument(value);
+    return count;
+}
+
+bool HeadlessSimulator::parseParameter(const std::string &argument)
+{
+    size_t separator = argument.find('=');
+    if (separator == std::string::npos || separator == 0)
+    {
+        std::cerr << "Expected <name>=<values> for --param, got " << argument << std::endl;
+        return false;
+    }
+    std::string name = argument.substr(0, separator);
+    std::string values = argument.substr(separator + 1);
+    std::vector<double> parsed;
+    if (std::count(values.begin(), values.end(), ':') == 2)
+    {
+        size_t first = values.find(':');
+        size_t second = values.find(':', first + 1);
+        double from = std::stod(values.substr(0, first));
+        double to = std::stod(values.substr(first + 1, second - first - 1));
+        double step = std::stod(values.substr(second + 1));
+        if (!(step > 0) || to < from)
+        {
+            std::cerr << "Invalid range for parameter " << name << ": " << values << std::endl;
+            return false;
+        }
+        // count the values instead of accumulating, so the last one is not lost to rounding
+        size_t count = static_cast<size_t>(std::floor((to - from) / step + 1e-9)) + 1;
+        for (size_t i = 0; i < count; i++)
+            parsed.push_back(from + i * step);
+    }
+    else
+    {
+        std::stringstream stream(values);
+        std::string value;
+        while (std::getline(stream, value, ','))
+            parsed.push_back(std::stod(value));
+    }
+    if (parsed.empty())
+    {
+        std::cerr << "No values for parameter " << name << std::endl;
+        return false;
+    }
+    // the same check as for --rate, the timestep is 1 / rate
+    if (name == "rate" && std::any_of(parsed.begin(), parsed.end(), [](double rate)
+                                      { return !(rate > 0); }))
+    {
+        std::cerr << "Physics rate has to be positive, got " << values << std::endl;
+        return false;
+    }
+    sweepParameters.emplace_back(name, std::move(parsed));
+    return true;
+}
+
+int HeadlessSimulator::run(int argc, char **argv)
+{
+    if (!parseArguments(argc, argv))
+    {
+        printUsage();
+        return 1;
+    }
+    if (!replayPath.empty())
+        return replay(replayPath);
+    if (batch)
+        return runBatch();
+    if (sceneNames.empty())
+    {
+        std::cout << "No scenes available! Did you forget to add your scene to SceneIndex.h?" << std::endl;
+        return 1;
+    }
+    for (auto &sceneName : sceneNames)
+    {
+        printStatistics(sceneName, runScene(sceneName));
+    }
+    return 0;
+}
+
+HeadlessSimulator::StepStatistics HeadlessSimulator::runScene(const std::string &sceneName, const ParameterSet &parameters)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    auto startTime = clock::now();
+    std::unique_ptr<Scene> scene = scenesCreators.at(sceneName)();
+    scene->timestep = 1.0f / physicsRate;
+    bool parametersApplied = true;
+    for (auto &parameter : parameters)
+    {
+        if (parameter.first == "rate")
+            scene->timestep = static_cast<float>(1.0 / parameter.second);
+        else if (!scene->setParameter(parameter.first, parameter.second))
+            parametersApplied = false;
+    }
+    scene->init();
+    if (!loadStatePath.empty() && !restoreState(*scene, sceneName))
+        std::cerr << "Could not restore the state of \"" << sceneName << "\" from " << loadStatePath << std::endl;
+    double initTime = std::chrono::duration<double>(clock::now() - startTime).count();
+
+    for (size_t i = 0; i < warmupSteps; i++)
+        scene->simulateStep();
+
+    std::vector<double> stepTimes;
+    stepTimes.reserve(steps);
+    for (size_t i = 0; i < steps; i++)
+    {
+        auto stepStart = clock::now();
+        scene->simulateStep();
+        stepTimes.push_back(std::chrono::duration<double>(clock::now() - stepStart).count());
+    }
+
+    // the final state is only needed for --save-state and the state hash column of batches
+    SceneSnapshot finalState;
+    if (batch || !saveStatePath.empty())
+    {
+        StateWriter writer(sceneName);
+        if (scene->saveState(writer))
+            finalState = writer.finish();
+    }
+    // batch runs would all write to the same file
+    if (!saveStatePath.empty() && !batch && !finalState.saveToFile(saveStatePath))
+        std::cerr << "Could not save the state of \"" << sceneName << "\" to " << saveStatePath << std::endl;
+
+    StepStatistics statistics = computeStatistics(std::move(stepTimes));
+    statistics.initTime = initTime;
+    statistics.stateHash = finalState.hash();
+    statistics.parametersApplied = parametersApplied;
+    return statistics;
+}
+
+int HeadlessSimulator::runBatch()
+{
+    // all combinations of the swept parameters, the first parameter changes slowest
+    std::vector<ParameterSet> combinations = {{}};
+    for (auto &parameter : sweepParameters)
+    {
+        std::vector<ParameterSet> extended;
+        for (auto &combination : combinations)
+        {
+            for (double value : parameter.second)
+            {
+                extended.push_back(combination);
+                extended.back().emplace_back(parameter.first, value);
+            }
+        }
+        combinations = std::move(extended);
+    }
+    std::vector<std::pair<std::string, ParameterSet>> jobs;
+    for (auto &sceneName : sceneNames)
+    {
+        for (auto &combination : combinations)
+        {
+            for (size_t i = 0; i < repeats; i++)
+                jobs.emplace_back(sceneName, combination);
+        }
+    }
+
+    ThreadPool pool(threadCount);
+    std::cout << "Running " << jobs.size() << " scene instances on " << pool.threadCount() << " threads" << std::endl;
+    std::vector<StepStatistics> results(jobs.size());
+    auto startTime = std::chrono::high_resolution_clock::now();
+    pool.parallelFor(jobs.size(), [&](size_t i)
+                     { results[i] = runScene(jobs[i].first, jobs[i].second); });
+    double batchTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    printBatchResults(jobs, results);
+    std::cout << "Batch finished in " << std::fixed << std::setprecision(3) << batchTime << " s" << std::endl;
+    if (!csvPath.empty() && !writeBatchCSV(jobs, results))
+    {
+        std::cerr << "Could not write " << csvPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+void HeadlessSimulator::printBatchResults(const std::vector<std::pair<std::string, ParameterSet>> &jobs, const std::vector<StepStatistics> &results)
+{
+    size_t sceneWidth = 5;
+    for (auto &job : jobs)
+        sceneWidth = std::max(sceneWidth, job.first.size());
+
+    std::cout << std::left << std::setw(sceneWidth) << "scene" << std::right;
+    for (auto &parameter : sweepParameters)
+        std::cout << " " << std::setw(std::max<size_t>(parameter.first.size(), 10)) << parameter.first;
+    std::cout << " " << std::setw(10) << "init [ms]" << " " << std::setw(10) << "mean [us]" << " " << std::setw(10) << "p95 [us]"
+              << " " << std::setw(10) << "max [us]" << " " << std::setw(12) << "steps/s" << "  state hash" << std::endl;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const StepStatistics &result = results[i];
+        std::cout << std::left << std::setw(sceneWidth) << jobs[i].first << std::right << std::fixed << std::setprecision(3);
+        for (size_t p = 0; p < sweepParameters.size(); p++)
+            std::cout << " " << std::setw(std::max<size_t>(sweepParameters[p].first.size(), 10)) << std::defaultfloat << jobs[i].second[p].second << std::fixed;
+        std::cout << " " << std::setw(10) << result.initTime * 1000 << " " << std::setw(10) << result.mean * 1e6
+                  << " " << std::setw(10) << result.p95 * 1e6 << " " << std::setw(10) << result.max * 1e6
+                  << " " << std::setw(12) << std::setprecision(1) << (result.totalTime > 0 ? result.steps / result.totalTime : 0.0) << "  ";
+        if (result.stateHash != 0)
+            std::cout << std::hex << std::setw(16) << std::setfill('0') << result.stateHash << std::dec << std::setfill(' ');
+        else
+            std::cout << "-";
+        if (!result.parametersApplied)
+            std::cout << "  (unknown parameter)";
+        std::cout << std::endl;
+    }
+}
+
+bool HeadlessSimulator::writeBatchCSV(const std::vector<std::pair<std::string, ParameterSet>> &jobs, const std::vector<StepStatistics> &results)
+{
+    std::ofstream file(csvPath);
+    if (!file)
+        return false;
+    file << "scene";
+    for (auto &parameter : sweepParameters)
+        file << "," << parameter.first;
+    file << ",parameters_applied,steps,init_ms,mean_us,min_us,median_us,p95_us,p99_us,max_us,total_ms,state_hash\n";
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const StepStatistics &result = results[i];
+        file << "\"" << jobs[i].first << "\"";
+        for (auto &parameter : jobs[i].second)
+            file << "," << parameter.second;
+        file << "," << result.parametersApplied << "," << result.steps << "," << result.initTime * 1000
+             << "," << result.mean * 1e6 << "," << result.min * 1e6 << "," << result.median * 1e6
+             << "," << result.p95 * 1e6 << "," << result.p99 * 1e6 << "," << result.max * 1e6
+             << "," << result.totalTime * 1000 << "," << std::hex << result.stateHash << std::dec << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool HeadlessSimulator::restoreState(Scene &scene, const std::string &sceneName)
+{
+    SceneSnapshot snapshot;
+    if (!snapshot.loadFromFile(loadStatePath) || !snapshot.isValid(sceneName))
+        return false;
+    return loadSnapshot(scene, snapshot);
+}
+
+bool HeadlessSimulator::loadSnapshot(Scene &scene, const SceneSnapshot &snapshot)
+{
+    StateReader reader(snapshot);
+    return scene.loadState(reader) && !reader.failed();
+}
+
+int HeadlessSimulator::replay(const std::string &path)
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    SessionRecording recording;
+    if (!recording.loadFromFile(path))
+    {
+        std::cerr << "No valid recording in " << path << std::endl;
+        return 1;
+    }
+    const std::string &sceneName = recording.sceneName;
+    if (scenesCreators.find(sceneName) == scenesCreators.end())
+    {
+        std::cerr << "Unknown scene \"" << sceneName << "\" in " << path << std::endl;
+        return 1;
+    }
+
+    // scenes may query ImGui input in simulateStep, so run a context without a window
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    // the recorded input is the state after trickling, apply it as a whole
+    io.ConfigInputTrickleEventQueue = false;
+    unsigned char *pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
+
+    auto startTime = clock::now();
+    std::unique_ptr<Scene> scene = scenesCreators[sceneName]();
+    scene->init();
+    if (!recording.initialState.empty() && !loadSnapshot(*scene, recording.initialState))
+    {
+        std::cerr << "Could not restore the initial state of \"" << sceneName << "\"" << std::endl;
+        ImGui::DestroyContext();
+        return 1;
+    }
+
+    std::vector<double> stepTimes;
+    stepTimes.reserve(recording.stepCount());
+    size_t checkedFrames = 0;
+    size_t mismatches = 0;
+    size_t firstMismatch = 0;
+    for (size_t i = 0; i < recording.frames.size(); i++)
+    {
+        const RecordedFrame &frame = recording.frames[i];
+        applyInput(frame);
+        if (frame.stateEvent >= 0 && !loadSnapshot(*scene, recording.stateEvents[frame.stateEvent]))
+            std::cerr << "Could not restore the state change in frame " << i << std::endl;
+
+        scene->timestep = frame.timestep;
+        for (uint32_t step = 0; step < frame.substeps; step++)
+        {
+            auto stepStart = clock::now();
+            scene->simulateStep();
+            stepTimes.push_back(std::chrono::duration<double>(clock::now() - stepStart).count());
+        }
+
+        if (frame.stateHash == 0)
+            continue;
+        StateWriter writer(sceneName);
+        if (!scene->saveState(writer))
+            continue;
+        checkedFrames++;
+        if (writer.finish().hash() != frame.stateHash)
+        {
+            if (mismatches == 0)
+                firstMismatch = i;
+            mismatches++;
+        }
+    }
+    double replayTime = std::chrono::duration<double>(clock::now() - startTime).count();
+    ImGui::DestroyContext();
+
+    printStatistics(sceneName, computeStatistics(std::move(stepTimes)));
+    std::cout << "Replayed " << recording.frames.size() << " frames in " << std::fixed << std::setprecision(3) << replayTime * 1000 << " ms, "
+              << recording.stateEvents.size() << " state changes" << std::endl;
+    if (checkedFrames == 0)
+        std::cout << "  no state hashes checked, the scene does not support snapshots" << std::endl;
+    else if (mismatches == 0)
+        std::cout << "  all " << checkedFrames << " state hashes match" << std::endl;
+    else
+        std::cout << "  " << mismatches << " of " << checkedFrames << " state hashes differ, first in frame " << firstMismatch << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+void HeadlessSimulator::applyInput(const RecordedFrame &frame)
+{
+    ImGuiIO &io = ImGui::GetIO();
+    io.DeltaTime = frame.deltaTime > 0 ? frame.deltaTime : 1e-6f;
+    io.DisplaySize = ImVec2(frame.displaySize.x, frame.displaySize.y);
+    io.AddMousePosEvent(frame.mousePos.x, frame.mousePos.y);
+    for (int i = 0; i < ImGuiMouseButton_COUNT; i++)
+        io.AddMouseButtonEvent(i, (frame.mouseDown >> i) & 1);
+    io.AddMouseWheelEvent(frame.mouseWheel.x, frame.mouseWheel.y);
+    io.AddKeyEvent(ImGuiMod_Ctrl, frame.modifiers & RecordedFrame::ModCtrl);
+    io.AddKeyEvent(ImGuiMod_Shift, frame.modifiers & RecordedFrame::ModShift);
+    io.AddKeyEvent(ImGuiMod_Alt, frame.modifiers & RecordedFrame::ModAlt);
+    io.AddKeyEvent(ImGuiMod_Super, frame.modifiers & RecordedFrame::ModSuper);
+    for (int key = RecordedFrame::firstKey; key < RecordedFrame::firstKey + RecordedFrame::keyCount; key++)
+        io.AddKeyEvent(static_cast<ImGuiKey>(key), frame.isKeyDown(key));
+    ImGui::NewFrame();
+    // there are no windows to hover, use what the GUI reported
+    io.WantCaptureMouse = frame.wantCaptureMouse;
+    io.WantCaptureKeyboard = frame.wantCaptureKeyboard;
+    ImGui::EndFrame();
+
+    // the camera is stored after Camera::update, so the drag state of the camera does not need to be replayed
+    Camera &camera = Renderer::camera;
+    camera.viewMatrix = frame.cameraView;
+    camera.position = frame.cameraPosition;
+    camera.width = frame.cameraWidth;
+    camera.height = frame.cameraHeight;
+}
+
+HeadlessSimulator::StepStatistics HeadlessSimulator::computeStatistics(std::vector<double> stepTimes)
+{
+    StepStatistics statistics;
+    statistics.steps = stepTimes.size();
+    if (stepTimes.empty())
+        return statistics;
+
+    std::sort(stepTimes.begin(), stepTimes.end());
+    statistics.totalTime = std::accumulate(stepTimes.begin(), stepTimes.end(), 0.0);
+    statistics.mean = statistics.totalTime / stepTimes.size();
+    statistics.min = stepTimes.front();
+    statistics.median = TimingHistory::percentile(stepTimes, 0.5);
+    statistics.p95 = TimingHistory::percentile(stepTimes, 0.95);
+    statistics.p99 = TimingHistory::percentile(stepTimes, 0.99);
+    statistics.max = stepTimes.back();
+    return statistics;
+}
+
+void HeadlessSimulator::printStatistics(const std::string &sceneName, const StepStatistics &statistics)
+{
+    std::cout << "Scene \"" << sceneName << "\": " << statistics.steps << " steps, init " << std::fixed << std::setprecision(3) << statistics.initTime * 1000 << " ms" << std::endl;
+    if (statistics.steps == 0)
+        return;
+    std::cout << "  step [us]: mean " << statistics.mean * 1e6
+              << ", min " << statistics.min * 1e6
+              << ", median " << statistics.median * 1e6
+              << ", p95 " << statistics.p95 * 1e6
+              << ", p99 " << statistics.p99 * 1e6
+              << ", max " << statistics.max * 1e6 << std::endl;
+    std::cout << "  total " << statistics.totalTime * 1000 << " ms";
+    if (statistics.totalTime > 0)
+        std::cout << ", " << std::setprecision(1) << statistics.steps / statistics.totalTime << " steps/s";
+    std::cout << std::endl;
+}
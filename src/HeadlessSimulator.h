@@ -0,0 +1,102 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "Scenes/Scene.h"
+#include <util/SessionRecording.h>
+
+/// @brief Runs scenes without a window or WebGPU device to measure raw physics throughput.
+///
+/// Start the application with `--headless` to use it. Additional arguments:
+///
+///     --scene <name>   Scene to run, as listed in SceneIndex.h. Can be given multiple times. Default: all scenes
+///     --steps <n>      Number of timed simulateStep calls. Default: 1000
+///     --warmup <n>     Number of untimed simulateStep calls before measuring. Default: 10
+///     --rate <hz>      Physics rate, each simulateStep advances the scene by 1 / rate seconds. Default: 60
+///     --load-state <file>  Start from a snapshot written by Scene::saveState instead of the freshly initialized state
+///     --save-state <file>  Write a snapshot after the last step, e.g. to start later runs from a settled state
+///     --param <name>=<values>  Run a batch sweeping a scene parameter, see Scene::setParameter. Can be given multiple times,
+///                      all combinations are run. Values are a list `1,2,4` or an inclusive range `from:to:step`.
+///                      `rate` sweeps the physics rate
+///     --repeat <n>     Run every combination n times, also starts a batch. Default: 1
+///     --threads <n>    Number of scene instances stepped concurrently in a batch. Default: one per hardware thread
+///     --csv <file>     Also write the batch results to a CSV file
+///     --replay <file>  Replay a session recorded in the GUI at maximum speed and compare the state after every frame.
+///                      The other arguments are ignored, the exit code is 1 if any state differs from the recording
+///
+/// Only Scene::init and Scene::simulateStep are called, onDraw and onGUI are skipped.
+class HeadlessSimulator
+{
+public:
+    /// @brief Parse the command line arguments, run all requested scenes and print the timings to stdout
+    /// @return
+    ///    The exit code of the application
+    int run(int argc, char **argv);
+
+    /// @brief Named parameter values passed to Scene::setParameter before init
+    using ParameterSet = std::vector<std::pair<std::string, double>>;
+
+    /// @brief Per step wall time statistics of a single run, all times in seconds
+    struct StepStatistics
+    {
+        /// SceneSnapshot::hash of the final state, 0 if the scene does not support snapshots
+        uint64_t stateHash = 0;
+        /// false if the scene did not accept one of the parameters
+        bool parametersApplied = true;
+        size_t steps = 0;
+        double initTime = 0;
+        double totalTime = 0;
+        double mean = 0;
+        double min = 0;
+        double median = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    /// @brief Create the scene, set the parameters, call init and time `steps` calls of simulateStep
+    ///
+    /// Thread safe as long as the scene does not share state between instances.
+    StepStatistics runScene(const std::string &sceneName, const ParameterSet &parameters = {});
+
+    /// @brief Run every requested scene with every combination of the swept parameters on a thread pool and print a table of the results
+    /// @return
+    ///    The exit code of the application
+    int runBatch();
+
+    /// @brief Replay a recorded session, feeding the recorded input, camera and timesteps to the scene
+    /// @return
+    ///    The exit code of the application
+    int replay(const std::string &path);
+
+    /// @brief Compute the statistics of a list of step times
+    static StepStatistics computeStatistics(std::vector<double> stepTimes);
+
+private:
+    bool parseArguments(int argc, char **argv);
+    static void printUsage();
+    /// @brief std::stoul, but throws std::invalid_argument for negative values and trailing characters instead of wrapping or ignoring them
+    static size_t parseCount(const std::string &value);
+    bool parseParameter(const std::string &argument);
+    void printBatchResults(const std::vector<std::pair<std::string, ParameterSet>> &jobs, const std::vector<StepStatistics> &results);
+    bool writeBatchCSV(const std::vector<std::pair<std::string, ParameterSet>> &jobs, const std::vector<StepStatistics> &results);
+    bool restoreState(Scene &scene, const std::string &sceneName);
+    static bool loadSnapshot(Scene &scene, const SceneSnapshot &snapshot);
+    /// @brief Hand the recorded input to ImGui and start and end a frame with it, then set the recorded camera
+    static void applyInput(const RecordedFrame &frame);
+    void printStatistics(const std::string &sceneName, const StepStatistics &statistics);
+
+    std::vector<std::string> sceneNames;
+    size_t steps = 1000;
+    size_t warmupSteps = 10;
+    float physicsRate = 60.0f;
+    std::string loadStatePath;
+    std::string saveStatePath;
+    std::string replayPath;
+    /// Swept parameters and their values, in the order given on the command line
+    std::vector<std::pair<std::string, std::vector<double>>> sweepParameters;
+    size_t repeats = 1;
+    size_t threadCount = 0;
+    std::string csvPath;
+    bool batch = false;
+};
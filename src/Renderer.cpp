@@ -90,10 +90,12 @@ Renderer::Renderer(bool _verbose): verbose(_verbose){
 }
 
 Camera Renderer::camera = Camera();
+std::atomic<uint64_t> Renderer::instanceCounter{0};
 
 void Renderer::onFrame()
 {
 	auto startTime = std::chrono::high_resolution_clock::now();
+	submitDrawList();
 	updateLightingUniforms();
 
 	if (reinitSwapChain)
@@ -120,6 +122,8 @@ void Renderer::onFrame()
 
 	// prepare image buffers
 	imagePipeline.commit();
+	auto commitEndTime = std::chrono::high_resolution_clock::now();
+	lastCommitTime = std::chrono::duration<double>(commitEndTime - startTime).count();
 
 	// std::cout << "Preparing to draw" << std::endl;
 	TextureView nextTextureView = GetNextSurfaceTextureView();
@@ -236,9 +240,12 @@ void Renderer::onFrame()
 
 	// targetView.release();
 	// swapChain.present();
-	lastDrawTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - startTime).count();
+	auto encodeEndTime = std::chrono::high_resolution_clock::now();
+	lastEncodeTime = std::chrono::duration<double>(encodeEndTime - commitEndTime).count();
+	lastDrawTime = std::chrono::duration<float>(encodeEndTime - startTime).count();
 
 	surface.present();
+	lastPresentTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - encodeEndTime).count();
 
 #ifdef WEBGPU_BACKEND_DAWN
 	// Check for pending error callbacks
@@ -450,7 +457,7 @@ void Renderer::setPresentMode(PresentMode mode)
 
 void Renderer::enableDepthSorting()
 {
-	sortDepth = true;
+	recordingDrawList().sortDepth = true;
 }
 
 void Renderer::initSwapChain()
@@ -601,16 +608,138 @@ void Renderer::terminateDepthBuffer()
 	depthTexture.release();
 }
 
-void Renderer::clearScene()
+void Renderer::DrawList::clear()
 {
-	instancingPipeline.clearAll();
-	linePipeline.clearAll();
-	imagePipeline.clearAll();
-	current_id = 0;
-	renderUniforms.flags = 0;
+	cubes.clear();
+	spheres.clear();
+	quads.clear();
+	lines.clear();
+	images.clear();
+	imageData.clear();
+	nextId = 0;
+	idBlockEnd = 0;
+	uniformFlags = 0;
 	sortDepth = false;
 }
 
+bool Renderer::DrawList::empty() const
+{
+	return cubes.empty() && spheres.empty() && quads.empty() && lines.empty() && images.empty() && uniformFlags == 0 && !sortDepth;
+}
+
+void Renderer::DrawList::append(const DrawList &other)
+{
+	cubes.insert(cubes.end(), other.cubes.begin(), other.cubes.end());
+	spheres.insert(spheres.end(), other.spheres.begin(), other.spheres.end());
+	quads.insert(quads.end(), other.quads.begin(), other.quads.end());
+	lines.insert(lines.end(), other.lines.begin(), other.lines.end());
+	int imageOffset = static_cast<int>(imageData.size());
+	for (auto image : other.images)
+	{
+		image.offset += imageOffset;
+		images.push_back(image);
+	}
+	imageData.insert(imageData.end(), other.imageData.begin(), other.imageData.end());
+	if (other.uniformFlags & UniformFlags::cullingPlane)
+		cullingOffsets = other.cullingOffsets;
+	uniformFlags |= other.uniformFlags;
+	sortDepth = sortDepth || other.sortDepth;
+}
+
+Renderer::DrawList &Renderer::recordingDrawList()
+{
+	// the draw lists of this thread, registered on its first draw call and released when it exits
+	struct Registration
+	{
+		uint64_t instanceId = 0;
+		std::shared_ptr<ThreadDrawLists> lists;
+
+		void release()
+		{
+			if (lists)
+				lists->threadExited.store(true, std::memory_order_release);
+			lists.reset();
+		}
+		~Registration() { release(); }
+	};
+	thread_local Registration registration;
+	if (registration.instanceId != instanceId)
+	{
+		registration.release();
+		std::lock_guard<std::mutex> lock(drawListsMutex);
+		threadDrawLists.push_back(std::make_shared<ThreadDrawLists>());
+		registration.lists = threadDrawLists.back();
+		registration.instanceId = instanceId;
+	}
+	return registration.lists->lists[recordingParity.load(std::memory_order_acquire)];
+}
+
+uint32_t Renderer::nextObjectId(DrawList &drawList)
+{
+	if (drawList.nextId == drawList.idBlockEnd)
+	{
+		uint32_t parity = recordingParity.load(std::memory_order_relaxed);
+		drawList.nextId = nextIdBlock[parity].fetch_add(idBlockSize, std::memory_order_relaxed);
+		drawList.idBlockEnd = drawList.nextId + idBlockSize;
+	}
+	return drawList.nextId++;
+}
+
+void Renderer::clearScene()
+{
+	// the id block is kept, it stays reserved for this list until the frame is submitted, the blocks after it
+	// may already belong to other threads
+	DrawList &drawList = recordingDrawList();
+	uint32_t nextId = drawList.nextId;
+	uint32_t idBlockEnd = drawList.idBlockEnd;
+	drawList.clear();
+	drawList.nextId = nextId;
+	drawList.idBlockEnd = idBlockEnd;
+}
+
+void Renderer::submitDrawList()
+{
+	// new draw calls go to the other lists from here on, the ones of this frame can be merged without locking them
+	uint32_t parity = recordingParity.load();
+	nextIdBlock[parity ^ 1] = 0;
+	recordingParity.store(parity ^ 1, std::memory_order_release);
+
+	std::lock_guard<std::mutex> lock(drawListsMutex);
+	std::vector<DrawList *> recorded;
+	for (auto &lists : threadDrawLists)
+	{
+		if (!lists->lists[parity].empty())
+			recorded.push_back(&lists->lists[parity]);
+	}
+	// a single recording thread is the common case, its lists can be swapped in without copying
+	DrawList *submitted = &mergedDrawList;
+	if (recorded.size() == 1)
+		submitted = recorded.front();
+	else
+	{
+		for (DrawList *drawList : recorded)
+			mergedDrawList.append(*drawList);
+	}
+
+	// the pipelines keep the recorded lists, the lists of the previous frame are returned for reuse
+	instancingPipeline.swapInstances(submitted->cubes, submitted->spheres, submitted->quads);
+	linePipeline.swapLines(submitted->lines);
+	imagePipeline.swapImages(submitted->images, submitted->imageData);
+	renderUniforms.flags = submitted->uniformFlags;
+	if (submitted->uniformFlags & UniformFlags::cullingPlane)
+		renderUniforms.cullingOffsets = submitted->cullingOffsets;
+	sortDepth = submitted->sortDepth;
+
+	mergedDrawList.clear();
+	for (DrawList *drawList : recorded)
+		drawList->clear();
+
+	// threads of std::async or a restarted pool come and go, drop their lists once nothing of them is left to submit
+	threadDrawLists.erase(std::remove_if(threadDrawLists.begin(), threadDrawLists.end(), [](const std::shared_ptr<ThreadDrawLists> &lists)
+										 { return lists->threadExited.load(std::memory_order_acquire) && lists->lists[0].empty() && lists->lists[1].empty(); }),
+						  threadDrawLists.end());
+}
+
 void Renderer::initUniforms()
 {
 	BufferDescriptor bufferDesc;
@@ -718,19 +847,23 @@ void Renderer::terminateGui()
 
 uint32_t Renderer::drawCube(glm::vec3 position, glm::quat rotation, glm::vec3 scale, glm::vec4 color, uint32_t flags)
 {
-	instancingPipeline.addCube({position,
-								rotation,
-								scale,
-								color,
-								current_id,
-								flags});
-	return current_id++;
+	DrawList &drawList = recordingDrawList();
+	uint32_t id = nextObjectId(drawList);
+	drawList.cubes.push_back({position,
+							  rotation,
+							  scale,
+							  color,
+							  id,
+							  flags});
+	return id;
 }
 
 uint32_t Renderer::drawEllipsoid(glm::vec3 position, glm::quat rotation, glm::vec3 scale, glm::vec4 color, uint32_t flags)
 {
-	instancingPipeline.addSphere({position, rotation, scale, color, current_id, flags});
-	return current_id++;
+	DrawList &drawList = recordingDrawList();
+	uint32_t id = nextObjectId(drawList);
+	drawList.spheres.push_back({position, rotation, scale, color, id, flags});
+	return id;
 }
 
 uint32_t Renderer::drawSphere(glm::vec3 position, float scale, glm::vec4 color, uint32_t flags)
@@ -740,13 +873,17 @@ uint32_t Renderer::drawSphere(glm::vec3 position, float scale, glm::vec4 color,
 
 uint32_t Renderer::drawQuad(glm::vec3 position, glm::quat rotation, glm::vec2 scale, glm::vec4 color, uint32_t flags)
 {
-	instancingPipeline.addQuad({position, rotation, vec3(scale.x, scale.y, 1), color, current_id, flags});
-	return current_id++;
+	DrawList &drawList = recordingDrawList();
+	uint32_t id = nextObjectId(drawList);
+	drawList.quads.push_back({position, rotation, vec3(scale.x, scale.y, 1), color, id, flags});
+	return id;
 }
 
 void Renderer::drawLine(glm::vec3 position1, glm::vec3 position2, glm::vec3 color1, glm::vec3 color2)
 {
-	linePipeline.addLine({{position1, color1}, {position2, color2}});
+	DrawList &drawList = recordingDrawList();
+	drawList.lines.push_back({position1, color1});
+	drawList.lines.push_back({position2, color2});
 }
 
 void Renderer::drawLine(glm::vec3 position1, glm::vec3 position2, glm::vec3 color)
@@ -834,15 +971,26 @@ void Renderer::drawImage(std::vector<float> data, int height, int width, float v
 	//  [4,5,6,7],
 	//  [8,9,10,11]]
 	// for width = 4, height = 3
-	for (float &value : data)
+	DrawList &drawList = recordingDrawList();
+	ResourceManager::ImageAttributes image;
+	image.x = screenPosition.x;
+	image.y = screenPosition.y;
+	image.sx = screenSize.x;
+	image.sy = screenSize.y;
+	image.offset = static_cast<int>(drawList.imageData.size());
+	image.width = width;
+	image.height = height;
+	image.cmapOffset = colormap.textureOffset();
+	drawList.images.push_back(image);
+	for (float value : data)
 	{
-		value = (value - vmin) / (vmax - vmin);
+		drawList.imageData.push_back((value - vmin) / (vmax - vmin));
 	}
-	imagePipeline.addImage(data, screenPosition, screenSize, width, height, colormap);
 }
 
 void Renderer::drawCullingPlanes(const glm::vec3 &offsets)
 {
-	renderUniforms.flags |= UniformFlags::cullingPlane;
-	renderUniforms.cullingOffsets = offsets;
+	DrawList &drawList = recordingDrawList();
+	drawList.uniformFlags |= UniformFlags::cullingPlane;
+	drawList.cullingOffsets = offsets;
 }
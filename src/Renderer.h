@@ -2,6 +2,9 @@
 #include <webgpu/webgpu.hpp>
 #include <glm/glm.hpp>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <memory>
 #include "ResourceManager.h"
 #include "pipelines/InstancingPipeline.h"
 #include "pipelines/LinePipeline.h"
@@ -17,8 +20,11 @@
 /// One instance of this class should be created in the main function of the application.
 /// The class is responsible for creating the window, initializing the device, and handling the rendering.
 /// After each onFrame call, the rendering engine will draw the scene and present it to the screen.
-/// renderer.clearScreen() should be called at the beginning of each frame to clear all added draw objects.
-/// Otherwise, the objects will be drawn in every frame.
+/// The draw functions record into a draw list that onFrame hands over to the GPU pipelines, so every object has to be drawn again each frame.
+///
+/// The draw functions are thread safe: every calling thread records into its own draw list, and onFrame merges the lists of all threads.
+/// The lists are double buffered, so recording the next frame may already start while onFrame submits the current one.
+/// Draw calls belonging to the current frame have to return before onFrame is called.
 class Renderer
 {
 
@@ -202,25 +208,25 @@ public:
 	/// @brief The background color of the scene
 	glm::vec3 backgroundColor = {0.05f, 0.05f, 0.05f};
 
-	/// @brief Get the number of spheres, ellipsoids, cubes and quads to be drawn next frame
+	/// @brief Get the number of spheres, ellipsoids, cubes and quads drawn in the current frame
 	/// @return
-	///    The number of objects to be drawn next frame
-	size_t objectCount()
-	{
-		return current_id;
-	};
+	///    The number of objects handed to the pipelines by the last onFrame call
+	size_t objectCount() { return instancingPipeline.objectCount(); };
 
-	/// @brief Get the number of lines to be drawn next frame
+	/// @brief Get the number of lines drawn in the current frame
 	/// @return
-	///    The number of lines to be drawn next frame
+	///    The number of lines handed to the pipelines by the last onFrame call
 	size_t lineCount() { return linePipeline.objectCount(); };
 
-	/// @brief Get the number of images to be drawn next frame
+	/// @brief Get the number of images drawn in the current frame
 	/// @return
-	///    The number of images to be drawn next frame
+	///    The number of images handed to the pipelines by the last onFrame call
 	size_t imageCount() { return imagePipeline.objectCount(); };
 
-	/// @brief Draw all current objects to the screen.
+	/// @brief Draw all recorded objects to the screen.
+	///
+	/// Hands the draw list recorded since the last call to the pipelines and starts recording a new, empty one.
+	/// Once the GUI has been defined, the draw list is not accessed anymore, so the next frame may be recorded from another thread.
 	void onFrame();
 
 	/// @brief Check if the window is still open. If the window is closed, the rendering engine will stop.
@@ -231,7 +237,8 @@ public:
 	/// @brief Callback function that is called when the window is resized
 	void onResize();
 
-	/// @brief Clear all objects that are currently drawn
+	/// @brief Discard the objects the calling thread recorded for the next frame
+	/// @details The lists of other threads are left alone, they may still be recording into them.
 	void clearScene();
 
 	/// @brief Enable or disable frame rate synchronization
@@ -249,6 +256,12 @@ public:
 
 	/// @brief Tracks the time taken up by the actual rendering last frame
 	double lastDrawTime = 0;
+	/// @brief Time spent merging the draw lists and uploading them to the GPU last frame, part of lastDrawTime
+	double lastCommitTime = 0;
+	/// @brief Time spent encoding and submitting the render passes including the GUI last frame, part of lastDrawTime
+	double lastEncodeTime = 0;
+	/// @brief Time spent presenting the last frame, including waiting for vsync
+	double lastPresentTime = 0;
 
 	/// @brief Flags to modify the rendering of objects
 	enum DrawFlags
@@ -341,11 +354,68 @@ private:
 	void terminateGui();
 	void updateGui(wgpu::RenderPassEncoder renderPass);
 
+	/// @brief Everything recorded by the draw functions of one thread for one frame
+	struct DrawList
+	{
+		std::vector<ResourceManager::InstancedVertexAttributes> cubes;
+		std::vector<ResourceManager::InstancedVertexAttributes> spheres;
+		std::vector<ResourceManager::InstancedVertexAttributes> quads;
+		/// Two vertices per line
+		std::vector<ResourceManager::LineVertexAttributes> lines;
+		std::vector<ResourceManager::ImageAttributes> images;
+		/// Pixel data of all images, concatenated
+		std::vector<float> imageData;
+		/// Next free object id of this list and the end of the id block reserved for it
+		uint32_t nextId = 0;
+		uint32_t idBlockEnd = 0;
+		/// Renderer::UniformFlags
+		uint32_t uniformFlags = 0;
+		glm::vec3 cullingOffsets = {0.0f, 0.0f, 1.0f};
+		bool sortDepth = false;
+
+		/// @brief Remove all recorded objects, keeps the allocated memory
+		void clear();
+		/// @brief Check whether nothing has been recorded
+		bool empty() const;
+		/// @brief Append everything recorded in another list
+		void append(const DrawList &other);
+	};
+
+	/// @brief The draw lists of one recording thread, indexed by recordingParity
+	struct ThreadDrawLists
+	{
+		DrawList lists[2];
+		/// Set when the thread exits, the lists are removed once everything it recorded has been submitted
+		std::atomic<bool> threadExited{false};
+	};
+
+	/// @brief Get the draw list of the calling thread for the frame currently being recorded
+	DrawList &recordingDrawList();
+	/// @brief Get a unique object id for the current frame, reserved in blocks to avoid contention between threads
+	uint32_t nextObjectId(DrawList &drawList);
+
+	/// @brief Flip the recording buffers, merge the recorded lists of all threads into the pipelines and clear them
+	void submitDrawList();
+
+	/// Number of ids a thread reserves at once
+	static constexpr uint32_t idBlockSize = 1024;
+	/// Distinguishes renderer instances in the thread local draw list lookup
+	static std::atomic<uint64_t> instanceCounter;
+	const uint64_t instanceId = ++instanceCounter;
+
+	std::mutex drawListsMutex;
+	/// Shared with the thread local registration of the thread, so either side can go away first
+	std::vector<std::shared_ptr<ThreadDrawLists>> threadDrawLists;
+	/// Which of the two lists of each thread is recorded into
+	std::atomic<uint32_t> recordingParity{0};
+	std::atomic<uint32_t> nextIdBlock[2] = {0, 0};
+	/// Scratch list for merging when several threads recorded
+	DrawList mergedDrawList;
+
 	using mat4 = glm::mat4;
 	using vec4 = glm::vec4;
 	using vec3 = glm::vec3;
 	using vec2 = glm::vec2;
-	uint32_t current_id = 0;
 	int width, height;
 	wgpu::PresentMode presentMode = wgpu::PresentMode::Fifo;
 	bool reinitSwapChain = false;
@@ -1,6 +1,9 @@
 #include "Simulator.h"
 #include <imgui.h>
+#include <cmath>
 #include "Scenes/SceneIndex.h"
+#include "PathFinder.h"
+#include <ctime>
 
 void Simulator::init()
 {
@@ -18,20 +21,441 @@ void Simulator::init()
         currentSceneName = sceneNames[0];
         currentScene = scenesCreators[currentSceneName]();
         currentScene->init();
+        resetTimestep();
     }
 }
 
+Simulator::~Simulator()
+{
+    if (worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            stopWorker = true;
+        }
+        workerCondition.notify_all();
+        worker.join();
+    }
+}
+
+void Simulator::prepareFrame()
+{
+    if (workerStepLaunched)
+    {
+        workerStepLaunched = false;
+        waitForWorkerStep();
+    }
+    else
+    {
+        if (recordingRequested)
+            startRecording();
+        if (isRecording)
+            recordStateChanges();
+        simulateStep();
+        if (isRecording)
+            recordSteps();
+        onDraw();
+    }
+    recordTimings();
+}
+
+SceneSnapshot Simulator::captureState()
+{
+    StateWriter writer(currentSceneName);
+    if (currentScene == nullptr || !currentScene->saveState(writer))
+        return SceneSnapshot();
+    return writer.finish();
+}
+
+void Simulator::startRecording()
+{
+    recordingRequested = false;
+    if (currentScene == nullptr)
+        return;
+    recording = SessionRecording();
+    recording.sceneName = currentSceneName;
+    recording.initialState = captureState();
+    if (recording.initialState.empty())
+    {
+        currentScene = scenesCreators[currentSceneName]();
+        currentScene->init();
+        resetTimestep();
+    }
+    lastStateHash = recording.initialState.hash();
+    isRecording = true;
+    recordingMessage.clear();
+}
+
+void Simulator::stopRecording()
+{
+    if (!isRecording)
+        return;
+    isRecording = false;
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+    auto path = binaryDirectory / (recording.sceneName + "_" + std::string(timestamp) + ".replay");
+    if (recording.saveToFile(path))
+    {
+        char message[256];
+        snprintf(message, sizeof(message), "Saved %zu frames, %zu steps, %zu state changes to ", recording.frames.size(), recording.stepCount(), recording.stateEvents.size());
+        recordingMessage = message + path.string();
+    }
+    else
+        recordingMessage = "Could not write " + path.string();
+    recording = SessionRecording();
+}
+
+void Simulator::recordInput()
+{
+    ImGuiIO &io = ImGui::GetIO();
+    RecordedFrame frame;
+    frame.deltaTime = io.DeltaTime;
+    frame.displaySize = vec2(io.DisplaySize.x, io.DisplaySize.y);
+    frame.mousePos = vec2(io.MousePos.x, io.MousePos.y);
+    frame.mouseWheel = vec2(io.MouseWheelH, io.MouseWheel);
+    for (int i = 0; i < ImGuiMouseButton_COUNT; i++)
+    {
+        if (io.MouseDown[i])
+            frame.mouseDown |= 1u << i;
+    }
+    if (io.KeyCtrl)
+        frame.modifiers |= RecordedFrame::ModCtrl;
+    if (io.KeyShift)
+        frame.modifiers |= RecordedFrame::ModShift;
+    if (io.KeyAlt)
+        frame.modifiers |= RecordedFrame::ModAlt;
+    if (io.KeySuper)
+        frame.modifiers |= RecordedFrame::ModSuper;
+    frame.wantCaptureMouse = io.WantCaptureMouse;
+    frame.wantCaptureKeyboard = io.WantCaptureKeyboard;
+    for (int key = RecordedFrame::firstKey; key < RecordedFrame::firstKey + RecordedFrame::keyCount; key++)
+        frame.setKeyDown(key, ImGui::IsKeyDown(static_cast<ImGuiKey>(key)));
+
+    Camera &camera = Renderer::camera;
+    frame.cameraView = camera.viewMatrix;
+    frame.cameraPosition = camera.position;
+    frame.cameraWidth = camera.width;
+    frame.cameraHeight = camera.height;
+    pendingFrame = frame;
+}
+
+void Simulator::recordStateChanges()
+{
+    SceneSnapshot state = captureState();
+    if (state.empty() || state.hash() == lastStateHash)
+        return;
+    lastStateHash = state.hash();
+    pendingFrame.stateEvent = static_cast<int32_t>(recording.stateEvents.size());
+    recording.stateEvents.push_back(std::move(state));
+}
+
+void Simulator::recordSteps()
+{
+    pendingFrame.timestep = currentScene->timestep;
+    pendingFrame.substeps = lastSubsteps;
+    pendingFrame.stateHash = captureState().hash();
+    lastStateHash = pendingFrame.stateHash;
+    recording.frames.push_back(pendingFrame);
+    pendingFrame.stateEvent = -1;
+}
+
+void Simulator::recordingGUI()
+{
+    using namespace ImGui;
+    if (!isRecording)
+    {
+        if (Button("Record Session"))
+            recordingRequested = true;
+        if (IsItemHovered())
+            SetTooltip("Record the input, camera, timesteps and GUI changes of this scene.\nReplay with --headless --replay <file> to reproduce the run.");
+    }
+    else
+    {
+        if (Button("Stop Recording"))
+            stopRecording();
+        SameLine();
+        Text("%zu frames, %zu state changes", recording.frames.size(), recording.stateEvents.size());
+    }
+    if (!recordingMessage.empty())
+        TextWrapped("%s", recordingMessage.c_str());
+}
+
+void Simulator::recordTimings()
+{
+    if (pauseTimings)
+        return;
+    stepHistory.add(lastStepTime);
+    drawPrepHistory.add(lastDrawPrepTime);
+    // the renderer timings belong to the previous frame, the current one has not been rendered yet
+    commitHistory.add(renderer.lastCommitTime);
+    encodeHistory.add(renderer.lastEncodeTime);
+    presentHistory.add(renderer.lastPresentTime);
+}
+
+void Simulator::timingsGUI()
+{
+    using namespace ImGui;
+    std::vector<TimingHistory *> histories = {&stepHistory, &drawPrepHistory, &commitHistory, &encodeHistory, &presentHistory};
+    Checkbox("Pause", &pauseTimings);
+    SameLine();
+    if (Button("Clear"))
+    {
+        for (auto history : histories)
+            history->clear();
+    }
+    SameLine();
+    if (Button("Export CSV"))
+    {
+        char timestamp[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+        auto path = binaryDirectory / ("timings_" + std::string(timestamp) + ".csv");
+        if (TimingHistory::writeCSV(path, histories))
+            timingsExportMessage = "Saved " + path.string();
+        else
+            timingsExportMessage = "Could not write " + path.string();
+    }
+    if (!timingsExportMessage.empty())
+        TextWrapped("%s", timingsExportMessage.c_str());
+
+    for (auto history : histories)
+    {
+        auto summary = history->summary();
+        char overlay[128];
+        snprintf(overlay, sizeof(overlay), "p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms", summary.p50 * 1000, summary.p95 * 1000, summary.p99 * 1000, summary.max * 1000);
+        auto getter = [](void *data, int i)
+        { return static_cast<float>(static_cast<const TimingHistory *>(data)->sample(i) * 1000); };
+        PlotLines(history->name.c_str(), getter, history, static_cast<int>(history->size()), 0, overlay, 0.0f, FLT_MAX, ImVec2(0, 50));
+    }
+}
+
+void Simulator::launchWorkerStep()
+{
+    if (!worker.joinable())
+        worker = std::thread(&Simulator::workerLoop, this);
+    {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        workerStepPending = true;
+    }
+    workerStepLaunched = true;
+    workerCondition.notify_all();
+}
+
+void Simulator::waitForWorkerStep()
+{
+    std::unique_lock<std::mutex> lock(workerMutex);
+    workerCondition.wait(lock, [this]()
+                         { return !workerStepPending; });
+}
+
+void Simulator::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(workerMutex);
+    while (true)
+    {
+        workerCondition.wait(lock, [this]()
+                             { return workerStepPending || stopWorker; });
+        if (stopWorker)
+            return;
+        lock.unlock();
+        // the render thread is past the GUI now and only submits and presents, so the scene and the draw list are ours
+        simulateStep();
+        onDraw();
+        lock.lock();
+        workerStepPending = false;
+        workerCondition.notify_all();
+    }
+}
+
+void Simulator::resetTimestep()
+{
+    accumulator = 0;
+    droppedTime = 0;
+    firstSimulateStep = true;
+    // a different scene has different costs and limits
+    stepCostEstimate = 0;
+    currentRate = 0;
+}
+
+void Simulator::updatePhysicsRate(double frameTime)
+{
+    double targetRate = glm::clamp(static_cast<double>(physicsRate), static_cast<double>(currentScene->minPhysicsRate), static_cast<double>(currentScene->maxPhysicsRate));
+    substepLimit = maxSubsteps;
+    if (!adaptiveRate || stepCostEstimate <= 0 || currentRate <= 0)
+    {
+        currentRate = targetRate;
+        return;
+    }
+    double budget = frameBudget / 1000.0;
+    // most steps per second that fit into the budget, if the next frames take as long as this one
+    double affordableRate = budget / (std::max(frameTime, 1e-4) * stepCostEstimate);
+    double rate = std::min(targetRate, affordableRate);
+    // back off quickly when over budget, recover slowly to avoid oscillating
+    rate = glm::clamp(rate, currentRate * 0.8, currentRate * 1.05);
+    currentRate = glm::clamp(rate, static_cast<double>(currentScene->minPhysicsRate), targetRate);
+    substepLimit = glm::clamp(static_cast<int>(budget / stepCostEstimate), 1, maxSubsteps);
+}
+
+void Simulator::loadScene(const std::string &sceneName)
+{
+    if (loadingScene.valid())
+        return;
+    loadingSceneName = sceneName;
+    loadingStartTime = std::chrono::high_resolution_clock::now();
+    auto createScene = scenesCreators[sceneName];
+    // only the new scene is touched on the loading thread, so init may take as long as it needs
+    loadingScene = std::async(std::launch::async, [createScene]()
+                              {
+                                  std::unique_ptr<Scene> scene = createScene();
+                                  scene->init();
+                                  return scene; });
+}
+
+void Simulator::applyLoadedScene()
+{
+    if (!loadingScene.valid() || loadingScene.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        return;
+    std::unique_ptr<Scene> scene = loadingScene.get();
+    // a reload shows up as a state change in the recording, as long as the scene supports snapshots
+    if (isRecording && (loadingSceneName != currentSceneName || recording.initialState.empty()))
+        stopRecording();
+    currentSceneName = loadingSceneName;
+    currentScene = std::move(scene);
+    resetTimestep();
+}
+
+void Simulator::saveSnapshot()
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    StateWriter writer(currentSceneName);
+    if (!currentScene->saveState(writer))
+    {
+        snapshotMessage = "This scene does not support snapshots";
+        return;
+    }
+    snapshots[currentSceneName] = writer.finish();
+    double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    char message[128];
+    snprintf(message, sizeof(message), "Saved %.1f KiB in %.3f ms", snapshots[currentSceneName].data.size() / 1024.0, time * 1000);
+    snapshotMessage = message;
+}
+
+void Simulator::restoreSnapshot()
+{
+    auto snapshot = snapshots.find(currentSceneName);
+    if (snapshot == snapshots.end())
+        return;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    StateReader reader(snapshot->second);
+    if (!currentScene->loadState(reader) || reader.failed())
+    {
+        snapshotMessage = "Could not restore the snapshot";
+        return;
+    }
+    resetTimestep();
+    double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    char message[128];
+    snprintf(message, sizeof(message), "Restored in %.3f ms", time * 1000);
+    snapshotMessage = message;
+}
+
+void Simulator::snapshotGUI()
+{
+    using namespace ImGui;
+    bool hasSnapshot = snapshots.find(currentSceneName) != snapshots.end();
+    auto path = binaryDirectory / (currentSceneName + ".snapshot");
+    if (Button("Save State"))
+        saveSnapshot();
+    SameLine();
+    if (!hasSnapshot)
+        BeginDisabled();
+    if (Button("Restore State"))
+        restoreSnapshot();
+    SameLine();
+    if (Button("Write File"))
+    {
+        if (snapshots[currentSceneName].saveToFile(path))
+            snapshotMessage = "Saved " + path.string();
+        else
+            snapshotMessage = "Could not write " + path.string();
+    }
+    if (!hasSnapshot)
+        EndDisabled();
+    SameLine();
+    if (Button("Read File"))
+    {
+        SceneSnapshot snapshot;
+        if (snapshot.loadFromFile(path) && snapshot.isValid(currentSceneName))
+        {
+            snapshots[currentSceneName] = std::move(snapshot);
+            restoreSnapshot();
+        }
+        else
+            snapshotMessage = "No valid snapshot in " + path.string();
+    }
+    if (!snapshotMessage.empty())
+        TextWrapped("%s", snapshotMessage.c_str());
+}
+
 void Simulator::simulateStep()
 {
     auto startTime = std::chrono::high_resolution_clock::now();
+    // real time since the last call
+    double frameTime = std::chrono::duration<double>(startTime - lastSimulateTime).count();
+    lastSimulateTime = startTime;
+
+    lastSubsteps = 0;
     if (currentScene != nullptr)
-        currentScene->simulateStep();
+    {
+        if (fixedTimestep)
+        {
+            updatePhysicsRate(frameTime);
+            double dt = 1.0 / currentRate;
+            // the very first frame advances by exactly one step
+            if (firstSimulateStep)
+                frameTime = dt;
+            accumulator += frameTime;
+            currentScene->timestep = static_cast<float>(dt);
+            while (accumulator >= dt && lastSubsteps < substepLimit)
+            {
+                currentScene->simulateStep();
+                accumulator -= dt;
+                lastSubsteps++;
+            }
+            // spiral of death: drop whole steps we could not afford this frame
+            if (accumulator >= dt)
+            {
+                double dropped = std::floor(accumulator / dt) * dt;
+                droppedTime += dropped;
+                accumulator -= dropped;
+            }
+            currentScene->interpolationAlpha = static_cast<float>(accumulator / dt);
+        }
+        else
+        {
+            if (firstSimulateStep)
+                frameTime = 1.0 / physicsRate;
+            accumulator = 0;
+            currentScene->timestep = static_cast<float>(frameTime);
+            currentScene->simulateStep();
+            currentScene->interpolationAlpha = 0;
+            lastSubsteps = 1;
+        }
+    }
+    firstSimulateStep = false;
     lastStepTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    if (lastSubsteps > 0)
+    {
+        double stepCost = lastStepTime / lastSubsteps;
+        stepCostEstimate = stepCostEstimate > 0 ? stepCostEstimate * 0.9 + stepCost * 0.1 : stepCost;
+    }
 }
 
 void Simulator::onGUI()
 {
     using namespace ImGui;
+    applyLoadedScene();
     if (currentScene == nullptr)
     {
         Begin("Game Physics", nullptr, ImGuiWindowFlags_NoTitleBar);
@@ -48,26 +472,59 @@ void Simulator::onGUI()
     Text("%ld objects, %ld lines, %ld images", renderer.objectCount(), renderer.lineCount(), renderer.imageCount());
     Separator();
     Text("Scene");
+    bool loading = loadingScene.valid();
+    if (loading)
+        BeginDisabled();
     if (BeginCombo("Scene", currentSceneName.c_str()))
     {
         for (auto &sceneName : sceneNames)
         {
             bool isSelected = (currentSceneName == sceneName);
             if (Selectable(sceneName.c_str(), isSelected))
-            {
-                currentSceneName = sceneName;
-                currentScene = scenesCreators[currentSceneName]();
-                currentScene->init();
-            }
+                loadScene(sceneName);
             if (isSelected)
                 SetItemDefaultFocus();
         }
         EndCombo();
     }
     if (Button("Reload Scene"))
+        loadScene(currentSceneName);
+    if (loading)
     {
-        currentScene = scenesCreators[currentSceneName]();
-        currentScene->init();
+        EndDisabled();
+        double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - loadingStartTime).count();
+        SameLine();
+        Text("Loading %s %c %.1f s", loadingSceneName.c_str(), "|/-\\"[static_cast<int>(elapsed * 8) % 4], elapsed);
+    }
+    snapshotGUI();
+    recordingGUI();
+    Separator();
+    if (CollapsingHeader("Timestep"))
+    {
+        Checkbox("Fixed Timestep", &fixedTimestep);
+        if (!fixedTimestep)
+            BeginDisabled();
+        if (DragFloat("Physics Rate (Hz)", &physicsRate, 1.0f, 1.0f, 10000.0f, "%.0f", ImGuiSliderFlags_Logarithmic))
+            physicsRate = glm::max(physicsRate, 1.0f);
+        SliderInt("Max Substeps", &maxSubsteps, 1, 64);
+        Checkbox("Adaptive Rate", &adaptiveRate);
+        if (IsItemHovered())
+            SetTooltip("Lower the physics rate and the substeps while the steps take longer than the frame budget.\nThe scene allows %.0f - %.0f Hz.", currentScene->minPhysicsRate, currentScene->maxPhysicsRate);
+        if (!adaptiveRate)
+            BeginDisabled();
+        DragFloat("Frame Budget (ms)", &frameBudget, 0.1f, 0.1f, 100.0f, "%.1f");
+        frameBudget = glm::max(frameBudget, 0.1f);
+        if (!adaptiveRate)
+            EndDisabled();
+        if (!fixedTimestep)
+            EndDisabled();
+        Text("Substeps: %d, dt: %.3f ms, alpha: %.2f", lastSubsteps, currentScene->timestep * 1000, currentScene->interpolationAlpha);
+        if (fixedTimestep)
+            Text("Rate: %.0f Hz, max substeps: %d, step cost: %.3f ms, budget used: %.0f%%", currentRate, substepLimit, stepCostEstimate * 1000, lastStepTime * 1000 / frameBudget * 100);
+        Text("Dropped: %.3f s", droppedTime);
+        Checkbox("Pipelined Simulation", &pipelined);
+        if (IsItemHovered())
+            SetTooltip("Step and draw the next frame on a worker thread while this frame is presented.\nScenes must not call ImGui outside of onGUI in this mode.");
     }
     Separator();
     if (CollapsingHeader(currentSceneName.c_str(), ImGuiTreeNodeFlags_DefaultOpen))
@@ -75,6 +532,11 @@ void Simulator::onGUI()
         currentScene->onGUI();
     }
     Separator();
+    if (CollapsingHeader("Timings"))
+    {
+        timingsGUI();
+    }
+    Separator();
     if (CollapsingHeader("Rendering"))
     {
         if ((renderer.supportedPresentModes.find(wgpu::PresentMode::Mailbox) == renderer.supportedPresentModes.end()) &&
@@ -118,6 +580,14 @@ void Simulator::onGUI()
     }
 
     End();
+
+    if (isRecording || recordingRequested)
+        recordInput();
+
+    // everything the GUI may touch is done, overlap the next step with the rest of Renderer::onFrame
+    // recorded frames need the state before and after the steps, so recording always steps on this thread
+    if (pipelined && !isRecording && !recordingRequested)
+        launchWorkerStep();
 }
 
 void Simulator::onDraw()
@@ -2,6 +2,13 @@
 #include "Renderer.h"
 #include "glm/glm.hpp"
 #include "Scenes/Scene.h"
+#include <util/TimingHistory.h>
+#include <util/SessionRecording.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
 
 /// @brief Backend for running and selecting different scenes.
 class Simulator
@@ -12,8 +19,18 @@ public:
         renderer.defineGUI = [this]()
         { onGUI(); };
     };
+    ~Simulator();
 
-    /// @brief Call simulateStep for the currently active Scene
+    /// @brief Step and draw the currently active Scene for the next frame. Call once per frame before Renderer::onFrame
+    ///
+    /// In pipelined mode, the worker thread already did this while the previous frame was rendered, so only wait for it to finish.
+    void prepareFrame();
+
+    /// @brief Advance the currently active Scene by the real time passed since the last call
+    ///
+    /// With a fixed timestep, the elapsed time is collected in an accumulator and consumed in substeps of 1 / physicsRate seconds.
+    /// At most maxSubsteps steps are taken per call, the remaining time is dropped to keep up under load.
+    /// With an adaptive rate, the rate is lowered towards Scene::minPhysicsRate while the measured step cost exceeds the frame budget.
     void simulateStep();
     /// @brief Call onDraw for the currently active Scene
     void onDraw();
@@ -31,7 +48,111 @@ private:
     std::string currentSceneName;
     std::vector<std::string> sceneNames;
 
+    /// @brief Reset the accumulator, e.g. after switching scenes
+    void resetTimestep();
+    /// @brief Choose currentRate and substepLimit for this frame from the scene limits and, if adaptive, the frame budget
+    void updatePhysicsRate(double frameTime);
+
+    /// @brief Create and initialize a scene on a background thread, the current scene keeps running until it is ready
+    void loadScene(const std::string &sceneName);
+    /// @brief Replace the current scene with the loaded one once its init has finished. Called at the start of onGUI, while no step is running
+    void applyLoadedScene();
+
+    /// @brief Store the state of the current scene in memory
+    void saveSnapshot();
+    /// @brief Restore the stored state of the current scene without re-running init
+    void restoreSnapshot();
+    /// @brief Show buttons for saving and restoring snapshots in memory and on disk
+    void snapshotGUI();
+
+    /// @brief Serialize the state of the current scene, empty if the scene does not support snapshots
+    SceneSnapshot captureState();
+
+    /// @brief Begin recording with the next frame, called from prepareFrame after a request from the GUI
+    ///
+    /// Scenes without snapshot support are reloaded, so the replay can start from a freshly initialized scene.
+    void startRecording();
+    /// @brief Stop recording and write the recording to the binary directory
+    void stopRecording();
+    /// @brief Store the ImGui input and the camera of this GUI frame for the next recorded frame
+    void recordInput();
+    /// @brief Store the state as a state event if it was changed outside of simulateStep since the last recorded frame
+    void recordStateChanges();
+    /// @brief Store the steps taken and the state hash, completing the recorded frame
+    void recordSteps();
+    /// @brief Show the controls for recording sessions
+    void recordingGUI();
+
+    /// @brief Add the timings of the last frame to the histories
+    void recordTimings();
+    /// @brief Show percentiles and plots of the timing histories and offer a CSV export
+    void timingsGUI();
+
+    /// @brief Let the worker thread step and draw the next frame, called at the end of onGUI
+    void launchWorkerStep();
+    /// @brief Block until the worker thread has finished the launched step
+    void waitForWorkerStep();
+    void workerLoop();
+
     double lastStepTime = 0;
     double lastDrawPrepTime = 0;
     bool limitFPS = true;
+
+    TimingHistory stepHistory{"step"};
+    TimingHistory drawPrepHistory{"draw_prep"};
+    TimingHistory commitHistory{"commit"};
+    TimingHistory encodeHistory{"encode"};
+    TimingHistory presentHistory{"present"};
+    bool pauseTimings = false;
+    std::string timingsExportMessage;
+
+    /// Scene being created and initialized by loadScene
+    std::future<std::unique_ptr<Scene>> loadingScene;
+    std::string loadingSceneName;
+    std::chrono::high_resolution_clock::time_point loadingStartTime;
+
+    /// Last saved snapshot per scene name
+    std::map<std::string, SceneSnapshot> snapshots;
+    std::string snapshotMessage;
+
+    /// Frames of the current scene recorded for a headless replay
+    SessionRecording recording;
+    bool isRecording = false;
+    bool recordingRequested = false;
+    /// Input of the last GUI frame, completed by the next prepareFrame
+    RecordedFrame pendingFrame;
+    uint64_t lastStateHash = 0;
+    std::string recordingMessage;
+
+    /// Off by default, so existing scenes keep stepping exactly once per frame
+    bool fixedTimestep = false;
+    float physicsRate = 60.0f;
+    int maxSubsteps = 8;
+    double accumulator = 0;
+    int lastSubsteps = 0;
+    double droppedTime = 0;
+    std::chrono::high_resolution_clock::time_point lastSimulateTime;
+    bool firstSimulateStep = true;
+
+    /// Pick the physics rate and substep limit each frame so the steps fit into frameBudget
+    bool adaptiveRate = false;
+    /// Simulation time budget per frame in milliseconds
+    float frameBudget = 8.0f;
+    /// Smoothed wall time of one Scene::simulateStep call in seconds, 0 until measured
+    double stepCostEstimate = 0;
+    /// Physics rate used in the last frame, after the adaptive controller and the scene limits
+    double currentRate = 0;
+    int substepLimit = 8;
+
+    /// Step and draw frame N+1 on the worker thread while the Renderer submits and presents frame N
+    bool pipelined = false;
+    std::thread worker;
+    std::mutex workerMutex;
+    std::condition_variable workerCondition;
+    /// Guarded by workerMutex, cleared by the worker when the step is done
+    bool workerStepPending = false;
+    bool stopWorker = false;
+    /// Only used by the render thread, whether prepareFrame has to wait for a step launched in the last frame
+    /// A pending flag read without the lock would be a data race, and could miss a step that already finished
+    bool workerStepLaunched = false;
 };
\ No newline at end of file
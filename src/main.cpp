@@ -1,5 +1,6 @@
 #include "Renderer.h"
 #include "Simulator.h"
+#include "HeadlessSimulator.h"
 #include "PathFinder.h"
 #include <GLFW/glfw3.h>
 
@@ -9,6 +10,13 @@ int main(int argc, char ** argv)
 	workingDirectory = fs::absolute(fs::path(argv[0])).remove_filename();
     binaryDirectory = fs::current_path();
   
+	// run scenes without window and device, see HeadlessSimulator.h for the arguments
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--headless")
+			return HeadlessSimulator().run(argc, argv);
+	}
+
 	bool verbose = false;
 	Renderer renderer = Renderer(verbose);
 	if(verbose)	
@@ -22,12 +30,9 @@ int main(int argc, char ** argv)
 		std::cout << "Simulator initialized" << std::endl;
 	while (renderer.isRunning())
 	{
-		simulator.simulateStep();
-		simulator.onDraw();
+		simulator.prepareFrame();
 		glfwPollEvents();
 		renderer.onFrame();
-		renderer.clearScene();
-
 	}
 	return 0;
 }
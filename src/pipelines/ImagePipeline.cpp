@@ -143,20 +143,12 @@ size_t ImagePipeline::objectCount()
     return images.size();
 };
 
-void ImagePipeline::addImage(std::vector<float> &data, glm::vec2 position, glm::vec2 scale, size_t width, size_t height, Colormap colormap)
+void ImagePipeline::swapImages(std::vector<ResourceManager::ImageAttributes> &images, std::vector<float> &data)
 {
-    int offset = this->data.size();
-    this->data.insert(this->data.end(), data.begin(), data.end());
-    ResourceManager::ImageAttributes image;
-    image.x = position.x;
-    image.y = position.y;
-    image.sx = scale.x;
-    image.sy = scale.y;
-    image.offset = offset;
-    image.width = width;
-    image.height = height;
-    image.cmapOffset = colormap.textureOffset();
-    images.push_back(image);
+    // keep the last layout in prevImages to detect when textures have to be recreated
+    prevImages.swap(this->images);
+    this->images.swap(images);
+    this->data.swap(data);
 }
 
 void ImagePipeline::clearAll()
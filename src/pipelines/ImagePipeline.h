@@ -8,7 +8,8 @@ class ImagePipeline : public Pipeline
 {
 public:
     bool init(wgpu::Device &device, wgpu::TextureFormat &swapChainFormat, wgpu::Queue &queue);
-    void addImage(std::vector<float> &data, glm::vec2 position, glm::vec2 scale, size_t width, size_t height, Colormap colormap);
+    /// @brief Hand over the images and their concatenated pixel data for the next commit. The previous lists are returned in the arguments.
+    void swapImages(std::vector<ResourceManager::ImageAttributes> &images, std::vector<float> &data);
     void draw(wgpu::RenderPassEncoder &renderPass) override;
     void commit() override;
     void clearAll() override;
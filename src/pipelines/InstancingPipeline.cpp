@@ -160,19 +160,12 @@ void InstancingPipeline::terminate()
     terminateGeometry();
 }
 
-void InstancingPipeline::addCube(ResourceManager::InstancedVertexAttributes cube)
+void InstancingPipeline::swapInstances(std::vector<InstancedVertexAttributes> &cubes, std::vector<InstancedVertexAttributes> &spheres, std::vector<InstancedVertexAttributes> &quads)
 {
-    instances[0].push_back(cube);
-}
-
-void InstancingPipeline::addSphere(ResourceManager::InstancedVertexAttributes sphere)
-{
-    instances[1].push_back(sphere);
-}
-
-void InstancingPipeline::addQuad(ResourceManager::InstancedVertexAttributes quad)
-{
-    instances[2].push_back(quad);
+    // same order as the primitives in initGeometry
+    instances[0].swap(cubes);
+    instances[1].swap(spheres);
+    instances[2].swap(quads);
 }
 
 template <typename T>
@@ -7,9 +7,8 @@ class InstancingPipeline : public Pipeline
 {
 public:
     void init(wgpu::Device &device, wgpu::Queue &queue, wgpu::TextureFormat &swapChainFormat, wgpu::TextureFormat &depthTextureFormat, wgpu::Buffer &cameraUniforms, wgpu::Buffer &lightingUniforms);
-    void addCube(ResourceManager::InstancedVertexAttributes cube);
-    void addSphere(ResourceManager::InstancedVertexAttributes sphere);
-    void addQuad(ResourceManager::InstancedVertexAttributes quad);
+    /// @brief Hand over the instances for the next commit. The lists previously held by the pipeline are returned in the arguments.
+    void swapInstances(std::vector<ResourceManager::InstancedVertexAttributes> &cubes, std::vector<ResourceManager::InstancedVertexAttributes> &spheres, std::vector<ResourceManager::InstancedVertexAttributes> &quads);
     void sortDepth();
     void clearAll() override;
     void commit() override;
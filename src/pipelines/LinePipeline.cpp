@@ -131,10 +131,9 @@ void LinePipeline::clearAll()
     lines.clear();
 }
 
-void LinePipeline::addLine(Line line)
+void LinePipeline::swapLines(std::vector<LineVertexAttributes> &lines)
 {
-    lines.push_back(line.start);
-    lines.push_back(line.end);
+    this->lines.swap(lines);
 }
 
 void LinePipeline::draw(RenderPassEncoder &renderPass)
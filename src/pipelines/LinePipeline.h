@@ -2,11 +2,6 @@
 #include "Pipeline.h"
 #include "ResourceManager.h"
 
-struct Line
-{
-    ResourceManager::LineVertexAttributes start;
-    ResourceManager::LineVertexAttributes end;
-};
 class LinePipeline : public Pipeline
 {
 public:
@@ -20,7 +15,8 @@ public:
     void terminate() override;
     void commit() override;
     void clearAll() override;
-    void addLine(Line line);
+    /// @brief Hand over the line vertices for the next commit, two per line. The previous vertices are returned in the argument.
+    void swapLines(std::vector<ResourceManager::LineVertexAttributes> &lines);
     void draw(wgpu::RenderPassEncoder &renderPass) override;
     size_t objectCount() override;
 
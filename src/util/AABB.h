@@ -0,0 +1,42 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// axis aligned bounding box, used by the broadphases to find candidate pairs for the narrowphase
+struct AABB
+{
+    glm::vec3 min = glm::vec3(0);
+    glm::vec3 max = glm::vec3(0);
+
+    // touching boxes count as overlapping
+    bool overlaps(const AABB &other) const
+    {
+        return min.x <= other.max.x && other.min.x <= max.x &&
+               min.y <= other.max.y && other.min.y <= max.y &&
+               min.z <= other.max.z && other.min.z <= max.z;
+    }
+
+    bool contains(const AABB &other) const
+    {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+               other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+    }
+
+    AABB merged(const AABB &other) const
+    {
+        return {glm::min(min, other.min), glm::max(max, other.max)};
+    }
+
+    AABB expanded(float margin) const
+    {
+        return {min - glm::vec3(margin), max + glm::vec3(margin)};
+    }
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 size() const { return max - min; }
+
+    float surfaceArea() const
+    {
+        glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
@@ -6,6 +6,15 @@
 #include <util/CollisionDetection.h>
 #include <glm/gtx/string_cast.hpp>
 
+// vectorized corner projection, SSE2 is part of every x86-64 target, AVX needs the USE_AVX2 CMake option
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COLLISION_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define COLLISION_SIMD_SSE
+#endif
+
 // tool data structures/functions called by the collision detection method, you can ignore the details here
 namespace collisionTools
 {
@@ -156,7 +165,8 @@ namespace collisionTools
         float denom = smOne * smTwo - dpOneTwo * dpOneTwo;
 
         // Zero denominator indicates parrallel lines
-        if (abs(denom) < 0.0001f)
+        // glm::abs, an unqualified abs may resolve to the int version depending on the included headers
+        if (glm::abs(denom) < 0.0001f)
         {
             return useOne ? pOne : pTwo;
         }
@@ -202,108 +212,309 @@ namespace collisionTools
         return vertex;
     }
 
+    OBB makeOBB(const mat4 &worldFromObj)
+    {
+        // same operations as getCorners, getAxisNormalToFaces and getBoxSize, so the results are bitwise identical
+        OBB box;
+        box.worldFromObj = worldFromObj;
+        box.center = worldFromObj * vec4(0, 0, 0, 1);
+        vec3 worldEdges[3];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            vec3 objEdge = vec3(0.0);
+            objEdge[i] = 0.5f;
+            worldEdges[i] = worldFromObj * vec4(objEdge, 0);
+            box.size[i] = 2.0f * glm::length(worldEdges[i]);
+            vec4 objAxis = vec4(0.0);
+            objAxis[i] = 1;
+            box.axes[i] = glm::normalize(worldFromObj * objAxis);
+        }
+        box.halfExtents = box.size * 0.5f;
+        for (int i = 0; i < 8; i++)
+        {
+            vec3 corner = box.center;
+            corner = (i & 1) ? corner + worldEdges[0] : corner - worldEdges[0];
+            corner = (i & 2) ? corner + worldEdges[1] : corner - worldEdges[1];
+            corner = (i & 4) ? corner + worldEdges[2] : corner - worldEdges[2];
+            box.corners[i] = corner;
+            box.cornersX[i] = corner.x;
+            box.cornersY[i] = corner.y;
+            box.cornersZ[i] = corner.z;
+        }
+        return box;
+    }
+
+    AABB computeAABB(const OBB &box)
+    {
+        AABB bounds{box.corners[0], box.corners[0]};
+        for (int i = 1; i < 8; i++)
+        {
+            bounds.min = glm::min(bounds.min, box.corners[i]);
+            bounds.max = glm::max(bounds.max, box.corners[i]);
+        }
+        return bounds;
+    }
+
+#if defined(COLLISION_SIMD_AVX) || defined(COLLISION_SIMD_SSE)
+    // dot products of 4 corners with the axis, in the same order of operations as glm::dot: (x * ax + y * ay) + z * az
+    static inline __m128 dot4(const float *x, const float *y, const float *z, __m128 ax, __m128 ay, __m128 az)
+    {
+        __m128 xy = _mm_add_ps(_mm_mul_ps(_mm_load_ps(x), ax), _mm_mul_ps(_mm_load_ps(y), ay));
+        return _mm_add_ps(xy, _mm_mul_ps(_mm_load_ps(z), az));
+    }
+
+    // _mm_min_ps(a, b) and _mm_max_ps(a, b) return b on ties, so always pass the lower corner indices second.
+    // Like the scalar loop, the first of equal values wins, which keeps the sign of zero identical.
+    static inline Projection reduceProjection(__m128 min4, __m128 max4)
+    {
+        __m128 min2 = _mm_min_ps(_mm_movehl_ps(min4, min4), min4);
+        __m128 max2 = _mm_max_ps(_mm_movehl_ps(max4, max4), max4);
+        __m128 min1 = _mm_min_ss(_mm_shuffle_ps(min2, min2, _MM_SHUFFLE(1, 1, 1, 1)), min2);
+        __m128 max1 = _mm_max_ss(_mm_shuffle_ps(max2, max2, _MM_SHUFFLE(1, 1, 1, 1)), max2);
+        Projection p;
+        p.min = _mm_cvtss_f32(min1);
+        p.max = _mm_cvtss_f32(max1);
+        return p;
+    }
+#endif
+
+    Projection project(const OBB &box, vec3 axis)
+    {
+#if defined(COLLISION_SIMD_AVX)
+        __m256 ax = _mm256_set1_ps(axis.x);
+        __m256 ay = _mm256_set1_ps(axis.y);
+        __m256 az = _mm256_set1_ps(axis.z);
+        __m256 xy = _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(box.cornersX), ax), _mm256_mul_ps(_mm256_load_ps(box.cornersY), ay));
+        __m256 d = _mm256_add_ps(xy, _mm256_mul_ps(_mm256_load_ps(box.cornersZ), az));
+        __m128 low = _mm256_castps256_ps128(d);
+        __m128 high = _mm256_extractf128_ps(d, 1);
+        return reduceProjection(_mm_min_ps(high, low), _mm_max_ps(high, low));
+#elif defined(COLLISION_SIMD_SSE)
+        __m128 ax = _mm_set1_ps(axis.x);
+        __m128 ay = _mm_set1_ps(axis.y);
+        __m128 az = _mm_set1_ps(axis.z);
+        __m128 low = dot4(box.cornersX, box.cornersY, box.cornersZ, ax, ay, az);
+        __m128 high = dot4(box.cornersX + 4, box.cornersY + 4, box.cornersZ + 4, ax, ay, az);
+        return reduceProjection(_mm_min_ps(high, low), _mm_max_ps(high, low));
+#else
+        float min = glm::dot(box.corners[0], axis);
+        float max = min;
+        for (int i = 1; i < 8; i++)
+        {
+            float p = glm::dot(box.corners[i], axis);
+            if (p < min)
+            {
+                min = p;
+            }
+            else if (p > max)
+            {
+                max = p;
+            }
+        }
+        Projection p;
+        p.max = max;
+        p.min = min;
+        return p;
+#endif
+    }
+
+    static vec3 handleVertexToface(const OBB &box, const vec3 &toCenter)
+    {
+        float min = 1000;
+        vec3 vertex;
+        for (int i = 0; i < 8; i++)
+        {
+            float value = glm::dot(box.corners[i], toCenter);
+            if (value < min)
+            {
+                vertex = box.corners[i];
+                min = value;
+            }
+        }
+
+        return vertex;
+    }
+
     CollisionInfo checkCollisionSATHelper(const mat4 &worldFromObj_A, const mat4 &worldFromObj_B, vec3 size_A, vec3 size_B)
     {
-        CollisionInfo info;
-        info.isColliding = false;
-        vec3 collisionPoint = vec3(0.0);
-        float smallOverlap = 10000.0f;
-        vec3 axis;
+        OBB box_A = makeOBB(worldFromObj_A);
+        OBB box_B = makeOBB(worldFromObj_B);
+        box_A.size = size_A;
+        box_B.size = size_B;
+        return checkCollisionSAT(box_A, box_B);
+    }
+
+    // the axis of minimum overlap found by the SAT test
+    struct MinimumOverlapAxis
+    {
+        bool separated;
+        // 0: face axis of A, 1: face axis of B, 2: cross product of an edge pair
+        int fromWhere;
+        // index into the axes of A or B, or into the edge axes that are left after skipping parallel edges, which
+        // contactFromAxis reads as the edge pair like the original implementation did
         int index;
-        int fromWhere = -1;
-        bool bestSingleAxis = false;
-        vec3 toCenter = getVectorConnnectingCenters(worldFromObj_A, worldFromObj_B);
-        std::vector<vec3> axes1 = getAxisNormalToFaces(worldFromObj_A);
-        std::vector<vec3> axes2 = getAxisNormalToFaces(worldFromObj_B);
-        std::vector<vec3> axes3 = getPairOfEdges(worldFromObj_A, worldFromObj_B);
+        // the edge pair 3 * i + j of the edge axis, for the feature id
+        int edgePair;
+        vec3 axis;
+        float overlap;
+        // true if a face axis of B was the minimum at some point, used to pick the edge in contactPoint
+        bool bestSingleAxis;
+        // the face axis with the smallest overlap, fromWhere 0 or 1
+        int faceFromWhere;
+        int faceIndex;
+        float faceOverlap;
+    };
+
+    // the separating axis stored in the cache, or a zero vector if there is none
+    static vec3 cachedAxis(const OBB &box_A, const OBB &box_B, const SeparatingAxisCache &cache)
+    {
+        switch (cache.fromWhere)
+        {
+        case 0:
+            return box_A.axes[cache.index];
+        case 1:
+            return box_B.axes[cache.index];
+        case 2:
+        {
+            vec3 vector = glm::cross(box_A.axes[cache.index / 3], box_B.axes[cache.index % 3]);
+            if (glm::length(vector) > 0)
+                return glm::normalize(vector);
+        }
+        }
+        return vec3(0.0f);
+    }
+
+    static MinimumOverlapAxis findMinimumOverlapAxis(const OBB &box_A, const OBB &box_B, SeparatingAxisCache *cache = nullptr)
+    {
+        MinimumOverlapAxis result;
+        result.separated = true;
+        result.fromWhere = -1;
+        result.index = 0;
+        result.edgePair = 0;
+        result.overlap = 10000.0f;
+        result.bestSingleAxis = false;
+        result.faceFromWhere = -1;
+        result.faceIndex = 0;
+        result.faceOverlap = result.overlap;
+        if (cache != nullptr && cache->fromWhere >= 0)
+        {
+            // one projection for pairs that are still separated along the axis of the last call
+            vec3 axis = cachedAxis(box_A, box_B, *cache);
+            if (axis != vec3(0.0f) && !overlap(project(box_A, axis), project(box_B, axis)))
+                return result;
+        }
+        const vec3 *axes1 = box_A.axes;
+        const vec3 *axes2 = box_B.axes;
+        // the edge pairs, parallel edges are skipped as in getPairOfEdges
+        vec3 axes3[9];
+        uint8_t edgePairs[9];
+        int edgeAxisCount = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                vec3 vector = glm::cross(axes1[i], axes2[j]);
+                if (glm::length(vector) > 0)
+                {
+                    edgePairs[edgeAxisCount] = static_cast<uint8_t>(3 * i + j);
+                    axes3[edgeAxisCount++] = glm::normalize(vector);
+                }
+            }
+        }
+        auto separatedAlong = [&](int fromWhere, int index)
+        {
+            if (cache != nullptr)
+            {
+                cache->fromWhere = static_cast<int8_t>(fromWhere);
+                cache->index = static_cast<uint8_t>(index);
+            }
+            return result;
+        };
         // loop over the axes1
-        for (int i = 0; i < axes1.size(); i++)
+        for (int i = 0; i < 3; i++)
         {
             // project both shapes onto the axis
-            Projection p1 = project(worldFromObj_A, axes1[i]);
-            Projection p2 = project(worldFromObj_B, axes1[i]);
+            Projection p1 = project(box_A, axes1[i]);
+            Projection p2 = project(box_B, axes1[i]);
             // do the projections overlap?
             if (!overlap(p1, p2))
             {
                 // then we can guarantee that the shapes do not overlap
-                return info;
+                return separatedAlong(0, i);
             }
-            else
+            // get the overlap
+            float o = getOverlap(p1, p2);
+            // check for minimum
+            if (o < result.overlap)
             {
-                // get the overlap
-                float o = getOverlap(p1, p2);
-                // check for minimum
-                if (o < smallOverlap)
-                {
-                    // then set this one as the smallest
-                    smallOverlap = o;
-                    axis = axes1[i];
-                    index = i;
-                    fromWhere = 0;
-                }
+                // then set this one as the smallest
+                result.overlap = o;
+                result.axis = axes1[i];
+                result.index = i;
+                result.fromWhere = 0;
+                result.faceOverlap = o;
+                result.faceIndex = i;
+                result.faceFromWhere = 0;
             }
         }
         // loop over the axes2
-        for (int i = 0; i < axes2.size(); i++)
+        for (int i = 0; i < 3; i++)
         {
-            // project both shapes onto the axis
-            Projection p1 = project(worldFromObj_A, axes2[i]);
-            Projection p2 = project(worldFromObj_B, axes2[i]);
-            // do the projections overlap?
+            Projection p1 = project(box_A, axes2[i]);
+            Projection p2 = project(box_B, axes2[i]);
             if (!overlap(p1, p2))
             {
-                // then we can guarantee that the shapes do not overlap
-                return info;
+                return separatedAlong(1, i);
             }
-            else
+            float o = getOverlap(p1, p2);
+            if (o < result.overlap)
             {
-                // get the overlap
-                float o = getOverlap(p1, p2);
-                // check for minimum
-                if (o < smallOverlap)
-                {
-                    // then set this one as the smallest
-                    smallOverlap = o;
-                    axis = axes2[i];
-                    index = i;
-                    fromWhere = 1;
-                    bestSingleAxis = true;
-                }
+                result.overlap = o;
+                result.axis = axes2[i];
+                result.index = i;
+                result.fromWhere = 1;
+                result.bestSingleAxis = true;
+                result.faceOverlap = o;
+                result.faceIndex = i;
+                result.faceFromWhere = 1;
             }
         }
-        int whichEdges = 0;
         // loop over the axes3
-        for (int i = 0; i < axes3.size(); i++)
+        for (int i = 0; i < edgeAxisCount; i++)
         {
-            // project both shapes onto the axis
-            Projection p1 = project(worldFromObj_A, axes3[i]);
-            Projection p2 = project(worldFromObj_B, axes3[i]);
-            // do the projections overlap?
+            Projection p1 = project(box_A, axes3[i]);
+            Projection p2 = project(box_B, axes3[i]);
             if (!overlap(p1, p2))
             {
-                // then we can guarantee that the shapes do not overlap
-                return info;
+                return separatedAlong(2, edgePairs[i]);
             }
-            else
+            float o = getOverlap(p1, p2);
+            if (o < result.overlap)
             {
-                // get the overlap
-                float o = getOverlap(p1, p2);
-                // check for minimum
-                if (o < smallOverlap)
-                {
-                    // then set this one as the smallest
-                    smallOverlap = o;
-                    axis = axes3[i];
-                    index = i;
-                    whichEdges = i;
-                    fromWhere = 2;
-                }
+                result.overlap = o;
+                result.axis = axes3[i];
+                result.index = i;
+                result.edgePair = edgePairs[i];
+                result.fromWhere = 2;
             }
         }
         // if we get here then we know that every axis had overlap on it
         // so we can guarantee an intersection
-        vec3 normal;
-        switch (fromWhere)
+        result.separated = false;
+        if (cache != nullptr)
+            cache->fromWhere = -1;
+        return result;
+    }
+
+    // the collision normal pointing from A to B, and the single contact point of the original implementation
+    static void contactFromAxis(const OBB &box_A, const OBB &box_B, const MinimumOverlapAxis &best, vec3 &normal, vec3 &collisionPoint)
+    {
+        const vec3 *axes1 = box_A.axes;
+        const vec3 *axes2 = box_B.axes;
+        vec3 toCenter = box_B.center - box_A.center;
+        vec3 axis = best.axis;
+        int whichEdges = best.index;
+        switch (best.fromWhere)
         {
         case 0:
         {
@@ -312,7 +523,7 @@ namespace collisionTools
             {
                 normal = -normal;
             }
-            collisionPoint = handleVertexToface(worldFromObj_B, toCenter);
+            collisionPoint = handleVertexToface(box_B, toCenter);
         }
         break;
         case 1:
@@ -322,7 +533,7 @@ namespace collisionTools
             {
                 normal = -normal;
             }
-            collisionPoint = handleVertexToface(worldFromObj_A, toCenter * -1.0f);
+            collisionPoint = handleVertexToface(box_A, toCenter * -1.0f);
         }
         break;
         case 2:
@@ -348,33 +559,395 @@ namespace collisionTools
                 else if (glm::dot(axes2[i], normal) > 0)
                     ptOnTwoEdge[i] = -ptOnTwoEdge[i];
             }
-            ptOnOneEdge = worldFromObj_A * ptOnOneEdge;
-            ptOnTwoEdge = worldFromObj_B * ptOnTwoEdge;
+            ptOnOneEdge = box_A.worldFromObj * ptOnOneEdge;
+            ptOnTwoEdge = box_B.worldFromObj * ptOnTwoEdge;
             collisionPoint = contactPoint(ptOnOneEdge,
                                           axes1[whichEdges / 3],
-                                          size_A[whichEdges / 3],
+                                          box_A.size[whichEdges / 3],
                                           ptOnTwoEdge,
                                           axes2[whichEdges % 3],
-                                          size_B[whichEdges % 3],
-                                          bestSingleAxis);
+                                          box_B.size[whichEdges % 3],
+                                          best.bestSingleAxis);
         }
         break;
         }
+    }
+
+    CollisionInfo checkCollisionSAT(const OBB &box_A, const OBB &box_B)
+    {
+        return checkCollisionSAT(box_A, box_B, nullptr);
+    }
 
+    CollisionInfo checkCollisionSAT(const OBB &box_A, const OBB &box_B, SeparatingAxisCache *cache)
+    {
+        CollisionInfo info;
+        info.isColliding = false;
+        MinimumOverlapAxis best = findMinimumOverlapAxis(box_A, box_B, cache);
+        if (best.separated)
+            return info;
+        vec3 normal;
+        vec3 collisionPoint = vec3(0.0);
+        contactFromAxis(box_A, box_B, best, normal, collisionPoint);
         info.isColliding = true;
         info.collisionPointWorld = collisionPoint;
-        info.depth = smallOverlap;
+        info.depth = best.overlap;
         info.normalWorld = -normal;
         return info;
     }
 
-    CollisionInfo checkCollisionSAT(glm::mat4 &worldFromObj_A, glm::mat4 &worldFromObj_B)
+    // vertex of the clipped incident face, with the lines it lies on to build its feature id
+    // lines 0 to 3 are the edges of the incident face, 4 to 7 the side planes of the reference face
+    struct ClipVertex
+    {
+        vec3 position;
+        // line of the polygon edge ending at this vertex and of the one starting at it
+        uint32_t inLine, outLine;
+    };
+
+    // Sutherland-Hodgman step, keeps the part of the polygon with dot(p, planeNormal) <= planeOffset
+    // a convex polygon gains at most one vertex per plane, so 4 planes turn the incident quad into at most 8 vertices
+    static int clipPolygon(const ClipVertex *input, int count, vec3 planeNormal, float planeOffset, uint32_t planeLine, ClipVertex *output)
+    {
+        int outCount = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const ClipVertex &current = input[i];
+            const ClipVertex &next = input[(i + 1) % count];
+            float dCurrent = glm::dot(current.position, planeNormal) - planeOffset;
+            float dNext = glm::dot(next.position, planeNormal) - planeOffset;
+            if (dCurrent <= 0)
+                output[outCount++] = current;
+            // the edge crosses the plane, the part outside is replaced by a segment along the plane
+            if ((dCurrent < 0 && dNext > 0) || (dCurrent > 0 && dNext < 0))
+            {
+                ClipVertex &clipped = output[outCount++];
+                clipped.position = current.position + (next.position - current.position) * (dCurrent / (dCurrent - dNext));
+                clipped.inLine = dCurrent < 0 ? current.outLine : planeLine;
+                clipped.outLine = dCurrent < 0 ? planeLine : current.outLine;
+            }
+        }
+        return outCount;
+    }
+
+    // keep the deepest point, the one farthest from it and the two spanning the largest area on either side,
+    // that keeps the support polygon of a resting box close to the full clipped face
+    static void reduceContacts(const ContactPoint *candidates, int count, vec3 normal, ContactManifold &manifold)
+    {
+        if (count <= ContactManifold::maxPoints)
+        {
+            for (int i = 0; i < count; i++)
+                manifold.points[i] = candidates[i];
+            manifold.pointCount = count;
+            return;
+        }
+        int chosen[ContactManifold::maxPoints];
+        chosen[0] = 0;
+        for (int i = 1; i < count; i++)
+            if (candidates[i].depth > candidates[chosen[0]].depth)
+                chosen[0] = i;
+        vec3 first = candidates[chosen[0]].positionWorld;
+        chosen[1] = chosen[0] == 0 ? 1 : 0;
+        float farthest = -1;
+        for (int i = 0; i < count; i++)
+        {
+            float distance = glm::length2(candidates[i].positionWorld - first);
+            if (i != chosen[0] && distance > farthest)
+            {
+                farthest = distance;
+                chosen[1] = i;
+            }
+        }
+        vec3 edge = candidates[chosen[1]].positionWorld - first;
+        // signed area of the triangle with the first two points, positive on one side of their line, negative on the other
+        chosen[2] = -1;
+        chosen[3] = -1;
+        float maxArea = 0, minArea = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (i == chosen[0] || i == chosen[1])
+                continue;
+            float area = glm::dot(glm::cross(edge, candidates[i].positionWorld - first), normal);
+            if (chosen[2] < 0 || area > maxArea)
+            {
+                maxArea = area;
+                chosen[2] = i;
+            }
+        }
+        for (int i = 0; i < count; i++)
+        {
+            if (i == chosen[0] || i == chosen[1] || i == chosen[2])
+                continue;
+            float area = glm::dot(glm::cross(edge, candidates[i].positionWorld - first), normal);
+            if (chosen[3] < 0 || area < minArea)
+            {
+                minArea = area;
+                chosen[3] = i;
+            }
+        }
+        for (int i = 0; i < ContactManifold::maxPoints; i++)
+            manifold.points[i] = candidates[chosen[i]];
+        manifold.pointCount = ContactManifold::maxPoints;
+    }
+
+    // clip the face of the incident box most antiparallel to the reference face against the side planes of the reference face
+    static int clipFaceContacts(const OBB &reference, int referenceAxis, vec3 referenceNormal, const OBB &incident, bool referenceIsB, ContactPoint *contacts)
     {
-        using namespace collisionTools;
-        vec3 calSizeA = getBoxSize(worldFromObj_A);
-        vec3 calSizeB = getBoxSize(worldFromObj_B);
+        // incident face
+        int incidentAxis = 0;
+        float maxAlignment = -1;
+        for (int i = 0; i < 3; i++)
+        {
+            float alignment = glm::abs(glm::dot(incident.axes[i], referenceNormal));
+            if (alignment > maxAlignment)
+            {
+                maxAlignment = alignment;
+                incidentAxis = i;
+            }
+        }
+        float facing = glm::dot(incident.axes[incidentAxis], referenceNormal) > 0 ? -1.0f : 1.0f;
+        vec3 incidentCenter = incident.center + incident.axes[incidentAxis] * (facing * incident.halfExtents[incidentAxis]);
+        int u = (incidentAxis + 1) % 3;
+        int v = (incidentAxis + 2) % 3;
+        vec3 du = incident.axes[u] * incident.halfExtents[u];
+        vec3 dv = incident.axes[v] * incident.halfExtents[v];
+        ClipVertex polygon[8] = {{incidentCenter + du + dv, 3, 0}, {incidentCenter - du + dv, 0, 1}, {incidentCenter - du - dv, 1, 2}, {incidentCenter + du - dv, 2, 3}};
+        int count = 4;
 
-        return checkCollisionSATHelper(worldFromObj_A, worldFromObj_B, calSizeA, calSizeB);
+        // side planes of the reference face
+        ClipVertex clipped[8];
+        for (int k = 1; k <= 2 && count > 0; k++)
+        {
+            int side = (referenceAxis + k) % 3;
+            vec3 sideNormal = reference.axes[side];
+            float centerOffset = glm::dot(reference.center, sideNormal);
+            uint32_t planeLine = 4 + 2 * (k - 1);
+            count = clipPolygon(polygon, count, sideNormal, centerOffset + reference.halfExtents[side], planeLine, clipped);
+            count = clipPolygon(clipped, count, -sideNormal, -centerOffset + reference.halfExtents[side], planeLine + 1, polygon);
+        }
+
+        // the faces are numbered 2 * axis, +1 for the face on the negative side
+        uint32_t referenceFace = 2 * referenceAxis + (glm::dot(reference.axes[referenceAxis], referenceNormal) < 0 ? 1 : 0);
+        uint32_t incidentFace = 2 * incidentAxis + (facing < 0 ? 1 : 0);
+        uint32_t faceFeature = (referenceIsB ? 1u << 12 : 0u) | referenceFace << 9 | incidentFace << 6;
+
+        // keep the points below the reference face
+        float faceOffset = glm::dot(reference.center, referenceNormal) + reference.halfExtents[referenceAxis];
+        int contactCount = 0;
+        for (int i = 0; i < count; i++)
+        {
+            float separation = glm::dot(polygon[i].position, referenceNormal) - faceOffset;
+            if (separation <= 0)
+            {
+                contacts[contactCount].positionWorld = polygon[i].position;
+                contacts[contactCount].depth = -separation;
+                contacts[contactCount].featureId = faceFeature | polygon[i].outLine << 3 | polygon[i].inLine;
+                contactCount++;
+            }
+        }
+        return contactCount;
+    }
+
+    // relative amount by which an edge axis has to beat the best face axis to be used for the manifold
+    static constexpr float faceAxisTolerance = 1.05f;
+
+    ContactManifold checkCollisionSATManifold(const OBB &box_A, const OBB &box_B)
+    {
+        return checkCollisionSATManifold(box_A, box_B, nullptr);
+    }
+
+    ContactManifold checkCollisionSATManifold(const OBB &box_A, const OBB &box_B, SeparatingAxisCache *cache)
+    {
+        ContactManifold manifold;
+        manifold.isColliding = false;
+        manifold.pointCount = 0;
+        MinimumOverlapAxis best = findMinimumOverlapAxis(box_A, box_B, cache);
+        if (best.separated)
+            return manifold;
+        // faces and edges of resting boxes overlap by about the same amount, switching between a face and an edge contact
+        // from step to step would make the points jump, so a face axis is kept unless the edge pair is clearly better
+        if (best.fromWhere == 2 && best.faceFromWhere >= 0 && best.faceOverlap <= best.overlap * faceAxisTolerance + 0.0001f)
+        {
+            best.fromWhere = best.faceFromWhere;
+            best.index = best.faceIndex;
+            best.axis = best.faceFromWhere == 0 ? box_A.axes[best.faceIndex] : box_B.axes[best.faceIndex];
+            best.overlap = best.faceOverlap;
+        }
+        vec3 normal;
+        vec3 collisionPoint = vec3(0.0);
+        contactFromAxis(box_A, box_B, best, normal, collisionPoint);
+        manifold.isColliding = true;
+        manifold.normalWorld = -normal;
+
+        ContactPoint candidates[8];
+        int count = 0;
+        // the face of A points to B, the face of B to A, the points lie on the other box
+        if (best.fromWhere == 0)
+            count = clipFaceContacts(box_A, best.index, normal, box_B, false, candidates);
+        else if (best.fromWhere == 1)
+            count = clipFaceContacts(box_B, best.index, -normal, box_A, true, candidates);
+        if (count == 0)
+        {
+            // edge-edge contact, or the clipping lost every point to rounding
+            candidates[0].positionWorld = collisionPoint;
+            candidates[0].depth = best.overlap;
+            candidates[0].featureId = best.fromWhere == 2 ? featureEdgeEdge | best.edgePair : featureVertexFace | best.fromWhere << 2 | best.index;
+            count = 1;
+        }
+        reduceContacts(candidates, count, normal, manifold);
+        return manifold;
+    }
+
+    ContactManifold checkCollisionSATManifold(const glm::mat4 &worldFromObj_A, const glm::mat4 &worldFromObj_B)
+    {
+        return checkCollisionSATManifold(makeOBB(worldFromObj_A), makeOBB(worldFromObj_B));
+    }
+
+    CollisionInfo checkCollisionSAT(const glm::mat4 &worldFromObj_A, const glm::mat4 &worldFromObj_B)
+    {
+        return checkCollisionSAT(makeOBB(worldFromObj_A), makeOBB(worldFromObj_B));
+    }
+
+    mat4 BodyTransforms::worldFromObj(size_t body) const
+    {
+        mat4 translation = glm::translate(mat4(1.0), positions[body]);
+        mat4 scale = glm::scale(mat4(1.0), scales[body]);
+        return translation * glm::mat4_cast(rotations[body]) * scale;
+    }
+
+    // adds a filtered pair to the counters
+    static void countFiltered(const CollisionFilter &a, const CollisionFilter &b, FilterCounters &counters)
+    {
+        if (sameGroup(a, b))
+            counters.filteredByGroup++;
+        else
+            counters.filteredByMask++;
+    }
+
+    size_t filterPairs(const BodyTransforms &bodies, std::vector<BodyPair> &pairs, FilterCounters *counters)
+    {
+        if (counters != nullptr)
+            counters->candidatePairs += pairs.size();
+        if (bodies.filters.empty())
+            return 0;
+        size_t kept = 0;
+        for (const BodyPair &pair : pairs)
+        {
+            const CollisionFilter &a = bodies.filters[pair.a], &b = bodies.filters[pair.b];
+            if (canCollide(a, b))
+                pairs[kept++] = pair;
+            else if (counters != nullptr)
+                countFiltered(a, b, *counters);
+        }
+        size_t removed = pairs.size() - kept;
+        pairs.resize(kept);
+        return removed;
+    }
+
+    void BatchNarrowphase::forEachBatch(size_t count, const std::function<void(size_t, size_t)> &task)
+    {
+        size_t batch = std::max<size_t>(batchSize, 1);
+        size_t batches = (count + batch - 1) / batch;
+        auto runBatch = [&](size_t i)
+        { task(i * batch, std::min(count, (i + 1) * batch)); };
+        if (pool != nullptr)
+            pool->parallelFor(batches, runBatch);
+        else
+            for (size_t i = 0; i < batches; i++)
+                runBatch(i);
+    }
+
+    void BatchNarrowphase::updateBoxes(const BodyTransforms &bodies)
+    {
+        boxes.resize(bodies.size());
+        // every body once, instead of once per pair it is part of
+        forEachBatch(bodies.size(), [&](size_t begin, size_t end)
+                     {
+                         for (size_t i = begin; i < end; i++)
+                             boxes[i] = makeOBB(bodies.worldFromObj(i)); });
+    }
+
+    void BatchNarrowphase::markTestedPairs(const BodyTransforms &bodies, const BodyPair *pairs, size_t pairCount)
+    {
+        filterCounters = FilterCounters();
+        filterCounters.candidatePairs = pairCount;
+        pairTested.clear();
+        if (bodies.filters.empty())
+            return;
+        pairTested.resize(pairCount);
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            const CollisionFilter &a = bodies.filters[pairs[i].a], &b = bodies.filters[pairs[i].b];
+            pairTested[i] = canCollide(a, b);
+            if (!pairTested[i])
+                countFiltered(a, b, filterCounters);
+        }
+    }
+
+    void BatchNarrowphase::prepareAxisCaches(const BodyPair *pairs, size_t pairCount)
+    {
+        pairAxisCaches.assign(pairCount, nullptr);
+        if (!useAxisCache)
+        {
+            axisCaches.clear();
+            return;
+        }
+        runCount++;
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            // filtered pairs are never tested, so they need no cache
+            if (!pairTested.empty() && !pairTested[i])
+                continue;
+            // references to unordered_map elements stay valid when other elements are inserted
+            PairAxisCache &cache = axisCaches[static_cast<uint64_t>(pairs[i].a) << 32 | pairs[i].b];
+            // a pair listed twice would have two threads write the same cache, the repeats run without one
+            // the cache never changes the result, only how fast the separated pairs are found
+            if (cache.lastRun == runCount)
+                continue;
+            cache.lastRun = runCount;
+            pairAxisCaches[i] = &cache.axis;
+        }
+        for (auto it = axisCaches.begin(); it != axisCaches.end();)
+        {
+            if (it->second.lastRun != runCount)
+                it = axisCaches.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    void BatchNarrowphase::run(const BodyTransforms &bodies, const BodyPair *pairs, size_t pairCount, CollisionInfo *results)
+    {
+        updateBoxes(bodies);
+        markTestedPairs(bodies, pairs, pairCount);
+        prepareAxisCaches(pairs, pairCount);
+        CollisionInfo filtered = {};
+        // each pair writes only its own result, so the order does not depend on the scheduling
+        forEachBatch(pairCount, [&](size_t begin, size_t end)
+                     {
+                         for (size_t i = begin; i < end; i++)
+                         {
+                             if (!pairTested.empty() && !pairTested[i])
+                                 results[i] = filtered;
+                             else
+                                 results[i] = checkCollisionSAT(boxes[pairs[i].a], boxes[pairs[i].b], pairAxisCaches[i]);
+                         } });
+    }
+
+    void BatchNarrowphase::run(const BodyTransforms &bodies, const BodyPair *pairs, size_t pairCount, ContactManifold *results)
+    {
+        updateBoxes(bodies);
+        markTestedPairs(bodies, pairs, pairCount);
+        prepareAxisCaches(pairs, pairCount);
+        ContactManifold filtered = {};
+        forEachBatch(pairCount, [&](size_t begin, size_t end)
+                     {
+                         for (size_t i = begin; i < end; i++)
+                         {
+                             if (!pairTested.empty() && !pairTested[i])
+                                 results[i] = filtered;
+                             else
+                                 results[i] = checkCollisionSATManifold(boxes[pairs[i].a], boxes[pairs[i].b], pairAxisCaches[i]);
+                         } });
     }
 
     // example of using the checkCollisionSAT function
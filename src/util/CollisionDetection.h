@@ -2,8 +2,13 @@
 #include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <iostream>
+#include <cstdint>
+#include <unordered_map>
 #include <util/CollisionInfo.h>
+#include <util/ThreadPool.h>
+#include <util/AABB.h>
 
 // tool data structures/functions called by the collision detection method, you can ignore the details here
 namespace collisionTools
@@ -14,6 +19,30 @@ namespace collisionTools
         float min, max;
     };
 
+    // box with everything the SAT test needs precomputed, build it once per body and step with makeOBB
+    // fixed size arrays only, so testing a pair does not allocate
+    struct OBB
+    {
+        glm::mat4 worldFromObj;
+        glm::vec3 center;
+        // normalized world directions of the object x, y and z axes, as getAxisNormalToFaces
+        glm::vec3 axes[3];
+        // edge lengths along the axes, as getBoxSize
+        glm::vec3 size;
+        glm::vec3 halfExtents;
+        // world corners in the order of getCorners
+        glm::vec3 corners[8];
+        // the same corners as structure of arrays, for the vectorized projection
+        alignas(32) float cornersX[8];
+        alignas(32) float cornersY[8];
+        alignas(32) float cornersZ[8];
+    };
+
+    OBB makeOBB(const glm::mat4 &worldFromObj);
+
+    // tight world bounds of the box, e.g. for the broadphases
+    AABB computeAABB(const OBB &box);
+
     glm::vec3 getVectorConnnectingCenters(const glm::mat4 &worldFromObj_A, const glm::mat4 &worldFromObj_B);
     // Get Corners
     std::vector<glm::vec3> getCorners(const glm::mat4 &worldFromObj);
@@ -29,6 +58,8 @@ namespace collisionTools
 
     // project a shape on an axis
     Projection project(const glm::mat4 &worldFromObj, glm::vec3 axis);
+    // projects all 8 corners at once with AVX or SSE2 if available, bitwise identical to the scalar loop
+    Projection project(const OBB &box, glm::vec3 axis);
 
     bool overlap(Projection p1, Projection p2);
 
@@ -55,7 +86,148 @@ namespace collisionTools
     obj2World_A, the transfer matrix from object space of A to the world space
     obj2World_B, the transfer matrix from object space of B to the world space
     */
-    CollisionInfo checkCollisionSAT(glm::mat4 &worldFromObj_A, glm::mat4 &worldFromObj_B);
+    CollisionInfo checkCollisionSAT(const glm::mat4 &worldFromObj_A, const glm::mat4 &worldFromObj_B);
+
+    // same result as the matrix version, without allocations or recomputing corners and axes
+    CollisionInfo checkCollisionSAT(const OBB &box_A, const OBB &box_B);
+
+    // the axis that separated a pair in the last test, tested first in the next one
+    // separated pairs mostly stay separated along the same axis between steps, so the test costs one projection instead of up to 15
+    struct SeparatingAxisCache
+    {
+        // 0: face axis of A, 1: face axis of B, 2: cross product of an edge of A and an edge of B, -1: none
+        int8_t fromWhere = -1;
+        // face axis, or 3 * edge of A + edge of B
+        uint8_t index = 0;
+    };
+
+    // same result as without the cache, the cache is updated with the new separating axis, or cleared if the boxes collide
+    CollisionInfo checkCollisionSAT(const OBB &box_A, const OBB &box_B, SeparatingAxisCache *cache);
+
+    // ContactPoint::featureId of the manifold points, only meant to be compared for equality
+    // face contacts: bit 12 set if the reference face is on B, bits 9-11 the reference face, bits 6-8 the incident face
+    // and bits 0-5 the two lines crossing at the point, edges of the incident face or side planes of the reference face
+    constexpr uint32_t featureEdgeEdge = 1u << 13;   // | index of the edge pair
+    constexpr uint32_t featureVertexFace = 1u << 14; // | 4 if the face is on B | face axis, single point of a face contact whose clipping found nothing
+
+    // the id of the same feature for the boxes in the other order, B first
+    constexpr uint32_t swappedFeatureId(uint32_t featureId)
+    {
+        if (featureId & featureEdgeEdge)
+        {
+            uint32_t edgePair = featureId & 15;
+            return featureEdgeEdge | (edgePair % 3 * 3 + edgePair / 3);
+        }
+        if (featureId & featureVertexFace)
+            return featureId ^ 4;
+        return featureId ^ 1u << 12;
+    }
+
+    // same test and normal as checkCollisionSAT, but with up to 4 contact points
+    // face contacts clip the incident face against the reference face, edge-edge contacts have a single point
+    ContactManifold checkCollisionSATManifold(const glm::mat4 &worldFromObj_A, const glm::mat4 &worldFromObj_B);
+    ContactManifold checkCollisionSATManifold(const OBB &box_A, const OBB &box_B);
+    ContactManifold checkCollisionSATManifold(const OBB &box_A, const OBB &box_B, SeparatingAxisCache *cache);
+
+    // which bodies can collide, checked before any geometry work
+    // two bodies collide if the category of each is in the mask of the other and they are not in the same group
+    struct CollisionFilter
+    {
+        // bits of the layers the body is in, e.g. 1 for static geometry, 2 for debris, 4 for triggers
+        uint32_t category = 1;
+        // bits of the layers the body collides with
+        uint32_t mask = ~0u;
+        // bodies with the same nonzero group never collide, e.g. the parts of one object that overlap anyway
+        uint32_t group = 0;
+    };
+
+    inline bool sameGroup(const CollisionFilter &a, const CollisionFilter &b) { return a.group != 0 && a.group == b.group; }
+    inline bool masksMatch(const CollisionFilter &a, const CollisionFilter &b) { return (a.category & b.mask) != 0 && (b.category & a.mask) != 0; }
+    inline bool canCollide(const CollisionFilter &a, const CollisionFilter &b) { return !sameGroup(a, b) && masksMatch(a, b); }
+
+    // box bodies as structure of arrays, all arrays have one entry per body
+    struct BodyTransforms
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::quat> rotations;
+        // edge lengths of the box
+        std::vector<glm::vec3> scales;
+        // the only optional array, empty if every body can collide with every other
+        std::vector<CollisionFilter> filters;
+
+        size_t size() const { return positions.size(); }
+        // translate * rotate * scale, the matrix passed to checkCollisionSAT for this body
+        glm::mat4 worldFromObj(size_t body) const;
+        bool canCollide(size_t a, size_t b) const { return filters.empty() || collisionTools::canCollide(filters[a], filters[b]); }
+    };
+
+    struct BodyPair
+    {
+        uint32_t a, b;
+    };
+
+    // how many candidate pairs the filters removed, to see whether the layers of a scene pay off
+    struct FilterCounters
+    {
+        size_t candidatePairs = 0;
+        // pairs of the same group, counted here even if their masks do not match either
+        size_t filteredByGroup = 0;
+        size_t filteredByMask = 0;
+
+        size_t filteredPairs() const { return filteredByGroup + filteredByMask; }
+        // pairs left for the narrowphase
+        size_t testedPairs() const { return candidatePairs - filteredPairs(); }
+    };
+
+    // removes the pairs whose bodies cannot collide, e.g. from the output of a broadphase, the order of the rest is kept
+    // adds to counters if given, returns the number of removed pairs
+    size_t filterPairs(const BodyTransforms &bodies, std::vector<BodyPair> &pairs, FilterCounters *counters = nullptr);
+
+    // tests many candidate pairs at once, in parallel if a thread pool is given
+    // keep the object around between steps, it reuses the per body boxes
+    class BatchNarrowphase
+    {
+    public:
+        explicit BatchNarrowphase(ThreadPool *pool = nullptr) : pool(pool) {}
+
+        // results[i] is checkCollisionSAT of pairs[i], results has to hold pairCount entries
+        // the output is the same for any number of threads
+        // pairs removed by BodyTransforms::filters are not tested and not colliding
+        void run(const BodyTransforms &bodies, const BodyPair *pairs, size_t pairCount, CollisionInfo *results);
+        // the same with checkCollisionSATManifold
+        void run(const BodyTransforms &bodies, const BodyPair *pairs, size_t pairCount, ContactManifold *results);
+
+        // pairs per task handed to the thread pool
+        size_t batchSize = 256;
+        // keep a SeparatingAxisCache per pair between runs, pairs missing from a run lose theirs
+        // a pair listed more than once in a run only uses the cache for its first entry
+        bool useAxisCache = false;
+        // pairs of the last run, and how many of them the filters removed
+        FilterCounters filterCounters;
+
+    private:
+        void forEachBatch(size_t count, const std::function<void(size_t, size_t)> &task);
+        void updateBoxes(const BodyTransforms &bodies);
+        // marks the pairs to test in pairTested and counts the others
+        void markTestedPairs(const BodyTransforms &bodies, const BodyPair *pairs, size_t pairCount);
+        // look up the cache of every pair before the parallel part, which can then write to them without locking
+        void prepareAxisCaches(const BodyPair *pairs, size_t pairCount);
+
+        ThreadPool *pool;
+        std::vector<OBB> boxes;
+
+        struct PairAxisCache
+        {
+            SeparatingAxisCache axis;
+            uint32_t lastRun = 0;
+        };
+        std::unordered_map<uint64_t, PairAxisCache> axisCaches;
+        // cache of pairs[i], nullptr if useAxisCache is off
+        std::vector<SeparatingAxisCache *> pairAxisCaches;
+        // whether pairs[i] passed the filters, empty if the bodies have none
+        std::vector<uint8_t> pairTested;
+        uint32_t runCount = 0;
+    };
 
     // example of using the checkCollisionSAT function
     void testCheckCollision(int caseid);
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstdint>
 
 // the return structure, with these values, you should be able to calculate the impulse
 // the depth shouldn't be used in your impulse calculation, it is a redundant value
@@ -10,4 +11,21 @@ struct CollisionInfo
     glm::vec3 collisionPointWorld; // the position of the collision point in world space
     glm::vec3 normalWorld;         // the direction of the impulse to A, negative of the collision face of A
     float depth;                   // the distance of the collision point to the surface, not necessary.
+};
+
+struct ContactPoint
+{
+    glm::vec3 positionWorld; // on the surface of the incident box
+    float depth;             // penetration along the normal, positive when the boxes overlap
+    uint32_t featureId;      // identifies the box features that formed the point, stays the same while they stay in contact
+};
+
+// all contact points of a pair that share one normal, e.g. the clipped face of a box resting on another
+struct ContactManifold
+{
+    static constexpr int maxPoints = 4;
+    bool isColliding;
+    glm::vec3 normalWorld; // as CollisionInfo::normalWorld, the direction of the impulse to A
+    int pointCount;
+    ContactPoint points[maxPoints];
 };
\ No newline at end of file
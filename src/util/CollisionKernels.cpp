@@ -0,0 +1,243 @@
+#include <util/CollisionKernels.h>
+#include <util/CollisionDetection.h>
+#include <util/GJK.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/norm.hpp>
+
+namespace collisionTools
+{
+    using vec3 = glm::vec3;
+
+    static CollisionInfo noCollision()
+    {
+        CollisionInfo info;
+        info.isColliding = false;
+        return info;
+    }
+
+    // contact of two spheres, also used for the closest points of capsule segments
+    static CollisionInfo collideSpheres(vec3 center_A, float radius_A, vec3 center_B, float radius_B)
+    {
+        vec3 toB = center_B - center_A;
+        float distanceSquared = glm::length2(toB);
+        float radii = radius_A + radius_B;
+        if (distanceSquared > radii * radii)
+            return noCollision();
+        float distance = glm::sqrt(distanceSquared);
+        // concentric spheres can be separated in any direction
+        vec3 normal = distance > 0 ? toB / distance : vec3(0, 1, 0);
+        CollisionInfo info;
+        info.isColliding = true;
+        info.normalWorld = -normal;
+        info.depth = radii - distance;
+        info.collisionPointWorld = ((center_A + normal * radius_A) + (center_B - normal * radius_B)) * 0.5f;
+        return info;
+    }
+
+    // closest points of the segments p1 q1 and p2 q2 (Ericson, Real-Time Collision Detection 5.1.9)
+    static void closestPointsOfSegments(vec3 p1, vec3 q1, vec3 p2, vec3 q2, vec3 &c1, vec3 &c2)
+    {
+        vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+        float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+        float s = 0, t = 0;
+        if (a <= 1e-12f && e <= 1e-12f)
+        {
+            c1 = p1;
+            c2 = p2;
+            return;
+        }
+        if (a <= 1e-12f)
+        {
+            t = glm::clamp(f / e, 0.0f, 1.0f);
+        }
+        else
+        {
+            float c = glm::dot(d1, r);
+            if (e <= 1e-12f)
+            {
+                s = glm::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else
+            {
+                float b = glm::dot(d1, d2);
+                float denominator = a * e - b * b;
+                // parallel segments, any s works
+                s = denominator != 0 ? glm::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+                t = (b * s + f) / e;
+                if (t < 0)
+                {
+                    t = 0;
+                    s = glm::clamp(-c / a, 0.0f, 1.0f);
+                }
+                else if (t > 1)
+                {
+                    t = 1;
+                    s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+                }
+            }
+        }
+        c1 = p1 + d1 * s;
+        c2 = p2 + d2 * t;
+    }
+
+    static void capsuleSegment(const ConvexShape &capsule, vec3 &bottom, vec3 &top)
+    {
+        vec3 axis = capsule.rotation * vec3(0, capsule.halfExtents.y, 0);
+        bottom = capsule.position - axis;
+        top = capsule.position + axis;
+    }
+
+    CollisionInfo collideSphereSphere(const ConvexShape &sphere_A, const ConvexShape &sphere_B)
+    {
+        return collideSpheres(sphere_A.position, sphere_A.radius, sphere_B.position, sphere_B.radius);
+    }
+
+    CollisionInfo collideSphereBox(const ConvexShape &sphere, const ConvexShape &box)
+    {
+        // in the space of the box, where it spans -halfExtents to halfExtents
+        vec3 center = glm::conjugate(box.rotation) * (sphere.position - box.position);
+        vec3 closest = glm::clamp(center, -box.halfExtents, box.halfExtents);
+        vec3 offset = center - closest;
+        float distanceSquared = glm::length2(offset);
+        if (distanceSquared > sphere.radius * sphere.radius)
+            return noCollision();
+
+        vec3 outward;
+        float depth;
+        if (distanceSquared > 0)
+        {
+            float distance = glm::sqrt(distanceSquared);
+            outward = offset / distance;
+            depth = sphere.radius - distance;
+        }
+        else
+        {
+            // the center is inside the box, push it out through the nearest face
+            int axis = 0;
+            float faceDistance = box.halfExtents.x - glm::abs(center.x);
+            for (int i = 1; i < 3; i++)
+            {
+                float d = box.halfExtents[i] - glm::abs(center[i]);
+                if (d < faceDistance)
+                {
+                    faceDistance = d;
+                    axis = i;
+                }
+            }
+            outward = vec3(0);
+            outward[axis] = center[axis] < 0 ? -1.0f : 1.0f;
+            closest[axis] = outward[axis] * box.halfExtents[axis];
+            depth = sphere.radius + faceDistance;
+        }
+        vec3 normal = box.rotation * outward;
+        vec3 surfacePoint = box.position + box.rotation * closest;
+        CollisionInfo info;
+        info.isColliding = true;
+        // the sphere is pushed out of the box
+        info.normalWorld = normal;
+        info.depth = depth;
+        info.collisionPointWorld = (surfacePoint + (sphere.position - normal * sphere.radius)) * 0.5f;
+        return info;
+    }
+
+    CollisionInfo collideSphereCapsule(const ConvexShape &sphere, const ConvexShape &capsule)
+    {
+        vec3 bottom, top;
+        capsuleSegment(capsule, bottom, top);
+        vec3 segment = top - bottom;
+        float lengthSquared = glm::length2(segment);
+        float t = lengthSquared > 0 ? glm::clamp(glm::dot(sphere.position - bottom, segment) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        return collideSpheres(sphere.position, sphere.radius, bottom + segment * t, capsule.radius);
+    }
+
+    CollisionInfo collideCapsuleCapsule(const ConvexShape &capsule_A, const ConvexShape &capsule_B)
+    {
+        vec3 bottom_A, top_A, bottom_B, top_B;
+        capsuleSegment(capsule_A, bottom_A, top_A);
+        capsuleSegment(capsule_B, bottom_B, top_B);
+        vec3 closest_A, closest_B;
+        closestPointsOfSegments(bottom_A, top_A, bottom_B, top_B, closest_A, closest_B);
+        CollisionInfo info = collideSpheres(closest_A, capsule_A.radius, closest_B, capsule_B.radius);
+        // between the insides of the segments the closest points lie along the cross product of the axes, which stays
+        // exact when the axes cross and the direction between the closest points is only rounding noise
+        vec3 across = glm::cross(top_A - bottom_A, top_B - bottom_B);
+        vec3 toB = closest_B - closest_A;
+        float distance = glm::length(toB);
+        if (info.isColliding && glm::length2(across) > 1e-12f &&
+            (distance < 1e-5f || (distance < 1e-2f && glm::abs(glm::dot(toB, glm::normalize(across))) >= 0.999f * distance)))
+        {
+            vec3 normal = glm::normalize(across);
+            float gap = glm::dot(toB, normal);
+            if (gap < 0 || (gap == 0 && glm::dot(capsule_B.position - capsule_A.position, normal) < 0))
+                normal = -normal;
+            info.normalWorld = -normal;
+            info.depth = capsule_A.radius + capsule_B.radius - glm::abs(gap);
+            info.collisionPointWorld = ((closest_A + normal * capsule_A.radius) + (closest_B - normal * capsule_B.radius)) * 0.5f;
+        }
+        return info;
+    }
+
+    CollisionInfo collideBoxBox(const ConvexShape &box_A, const ConvexShape &box_B)
+    {
+        auto worldFromObj = [](const ConvexShape &box)
+        {
+            return glm::translate(glm::mat4(1.0f), box.position) * glm::mat4_cast(box.rotation) * glm::scale(glm::mat4(1.0f), box.halfExtents * 2.0f);
+        };
+        return checkCollisionSAT(makeOBB(worldFromObj(box_A)), makeOBB(worldFromObj(box_B)));
+    }
+
+    CollisionInfo collideSpherePlane(const ConvexShape &sphere, const ConvexShape &plane)
+    {
+        vec3 normal = plane.planeNormal();
+        float distance = glm::dot(normal, sphere.position) - plane.planeOffset();
+        if (distance > sphere.radius)
+            return noCollision();
+        CollisionInfo info;
+        info.isColliding = true;
+        info.normalWorld = normal;
+        info.depth = sphere.radius - distance;
+        // halfway between the lowest point of the sphere and the plane below the center
+        info.collisionPointWorld = sphere.position - normal * ((sphere.radius + distance) * 0.5f);
+        return info;
+    }
+
+    // the deepest point of a shape below the plane
+    static CollisionInfo collidePointPlane(vec3 deepest, const ConvexShape &plane)
+    {
+        vec3 normal = plane.planeNormal();
+        float distance = glm::dot(normal, deepest) - plane.planeOffset();
+        if (distance > 0)
+            return noCollision();
+        CollisionInfo info;
+        info.isColliding = true;
+        info.normalWorld = normal;
+        info.depth = -distance;
+        info.collisionPointWorld = deepest - normal * (distance * 0.5f);
+        return info;
+    }
+
+    CollisionInfo collideBoxPlane(const ConvexShape &box, const ConvexShape &plane)
+    {
+        // the corner farthest against the normal, one sign test per axis
+        vec3 normal = glm::conjugate(box.rotation) * plane.planeNormal();
+        vec3 corner(normal.x > 0 ? -box.halfExtents.x : box.halfExtents.x,
+                    normal.y > 0 ? -box.halfExtents.y : box.halfExtents.y,
+                    normal.z > 0 ? -box.halfExtents.z : box.halfExtents.z);
+        return collidePointPlane(box.position + box.rotation * corner, plane);
+    }
+
+    CollisionInfo collideConvexPlane(const ConvexShape &shape, const ConvexShape &plane)
+    {
+        return collidePointPlane(shape.support(-plane.planeNormal()), plane);
+    }
+
+    CollisionInfo collideConvexConvex(const ConvexShape &a, const ConvexShape &b)
+    {
+        return checkCollisionGJK(a, b);
+    }
+
+    CollisionInfo collideNone(const ConvexShape &, const ConvexShape &)
+    {
+        return noCollision();
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <util/ConvexShape.h>
+#include <util/CollisionInfo.h>
+
+// specialized narrowphase tests for shape pairs with a cheap analytic solution, picked by a table built at compile time
+//
+// Every kernel follows the conventions of checkCollisionSAT: normalWorld is the direction of the impulse to A and
+// depth the penetration along it. The point is halfway between the deepest points of the two shapes.
+// Pairs without a kernel of their own use box-box SAT or GJK and EPA.
+namespace collisionTools
+{
+    using CollisionKernel = CollisionInfo (*)(const ConvexShape &a, const ConvexShape &b);
+
+    CollisionInfo collideSphereSphere(const ConvexShape &sphere_A, const ConvexShape &sphere_B);
+    CollisionInfo collideSphereBox(const ConvexShape &sphere, const ConvexShape &box);
+    CollisionInfo collideSphereCapsule(const ConvexShape &sphere, const ConvexShape &capsule);
+    CollisionInfo collideCapsuleCapsule(const ConvexShape &capsule_A, const ConvexShape &capsule_B);
+    // checkCollisionSAT, so the depth is its overlap of the projections on the separating axis: where one box reaches
+    // past both sides of the other along that axis this is the extent of the smaller box, not how far it has to move
+    // to get out, and deep containment comes out too shallow compared with EPA, by up to the size of the smaller box
+    CollisionInfo collideBoxBox(const ConvexShape &box_A, const ConvexShape &box_B);
+    CollisionInfo collideSpherePlane(const ConvexShape &sphere, const ConvexShape &plane);
+    CollisionInfo collideBoxPlane(const ConvexShape &box, const ConvexShape &plane);
+    // any bounded shape against a plane, through the support point in the direction into the plane
+    CollisionInfo collideConvexPlane(const ConvexShape &shape, const ConvexShape &plane);
+    // GJK and EPA
+    CollisionInfo collideConvexConvex(const ConvexShape &a, const ConvexShape &b);
+    // planes are infinite, two of them never produce a useful contact
+    CollisionInfo collideNone(const ConvexShape &a, const ConvexShape &b);
+
+    // run a kernel written for (B, A) on (A, B)
+    template <CollisionKernel Kernel>
+    CollisionInfo collideSwapped(const ConvexShape &a, const ConvexShape &b)
+    {
+        CollisionInfo info = Kernel(b, a);
+        info.normalWorld = -info.normalWorld;
+        return info;
+    }
+
+    constexpr CollisionKernel selectKernel(ShapeType a, ShapeType b)
+    {
+        using T = ShapeType;
+        if (a == T::Plane && b == T::Plane)
+            return collideNone;
+        if (a == T::Sphere && b == T::Sphere)
+            return collideSphereSphere;
+        if (a == T::Sphere && b == T::Box)
+            return collideSphereBox;
+        if (a == T::Box && b == T::Sphere)
+            return collideSwapped<collideSphereBox>;
+        if (a == T::Sphere && b == T::Capsule)
+            return collideSphereCapsule;
+        if (a == T::Capsule && b == T::Sphere)
+            return collideSwapped<collideSphereCapsule>;
+        if (a == T::Capsule && b == T::Capsule)
+            return collideCapsuleCapsule;
+        if (a == T::Box && b == T::Box)
+            return collideBoxBox;
+        if (a == T::Sphere && b == T::Plane)
+            return collideSpherePlane;
+        if (a == T::Plane && b == T::Sphere)
+            return collideSwapped<collideSpherePlane>;
+        if (a == T::Box && b == T::Plane)
+            return collideBoxPlane;
+        if (a == T::Plane && b == T::Box)
+            return collideSwapped<collideBoxPlane>;
+        if (b == T::Plane)
+            return collideConvexPlane;
+        if (a == T::Plane)
+            return collideSwapped<collideConvexPlane>;
+        return collideConvexConvex;
+    }
+
+    using KernelTable = std::array<std::array<CollisionKernel, shapeTypeCount>, shapeTypeCount>;
+
+    constexpr KernelTable makeKernelTable()
+    {
+        KernelTable table{};
+        for (size_t a = 0; a < shapeTypeCount; a++)
+            for (size_t b = 0; b < shapeTypeCount; b++)
+                table[a][b] = selectKernel(static_cast<ShapeType>(a), static_cast<ShapeType>(b));
+        return table;
+    }
+
+    // kernelTable[type of A][type of B]
+    inline constexpr KernelTable kernelTable = makeKernelTable();
+
+    inline CollisionInfo checkCollision(const ConvexShape &a, const ConvexShape &b)
+    {
+        return kernelTable[static_cast<size_t>(a.type)][static_cast<size_t>(b.type)](a, b);
+    }
+}
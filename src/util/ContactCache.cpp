@@ -0,0 +1,102 @@
+#include <util/ContactCache.h>
+#include <algorithm>
+
+uint64_t ContactCache::pairKey(collisionTools::BodyPair pair)
+{
+    // the same key for both orders, the broadphases do not promise one
+    return static_cast<uint64_t>(std::min(pair.a, pair.b)) << 32 | std::max(pair.a, pair.b);
+}
+
+void ContactCache::turnAround(PairContacts &entry)
+{
+    std::swap(entry.pair.a, entry.pair.b);
+    entry.manifold.normalWorld = -entry.manifold.normalWorld;
+    for (int i = 0; i < entry.manifold.pointCount; i++)
+    {
+        entry.manifold.points[i].featureId = collisionTools::swappedFeatureId(entry.manifold.points[i].featureId);
+        entry.tangentImpulses[i] = -entry.tangentImpulses[i];
+    }
+}
+
+void ContactCache::beginStep()
+{
+    updatedPoints = 0;
+    warmStartedPoints = 0;
+    for (size_t i = 0; i < entries.size();)
+    {
+        if (entries[i].age <= maxAge)
+        {
+            entries[i].age++;
+            i++;
+            continue;
+        }
+        // swap with the last entry and drop it
+        index.erase(pairKey(entries[i].pair));
+        if (i + 1 < entries.size())
+        {
+            entries[i] = entries.back();
+            index[pairKey(entries[i].pair)] = static_cast<uint32_t>(i);
+        }
+        entries.pop_back();
+    }
+}
+
+ContactCache::PairContacts *ContactCache::update(collisionTools::BodyPair pair, const ContactManifold &manifold)
+{
+    if (!manifold.isColliding)
+        return nullptr;
+    auto [it, inserted] = index.try_emplace(pairKey(pair), static_cast<uint32_t>(entries.size()));
+    if (inserted)
+    {
+        PairContacts added;
+        added.pair = pair;
+        added.manifold.isColliding = false;
+        added.manifold.pointCount = 0;
+        entries.push_back(added);
+    }
+    PairContacts &entry = entries[it->second];
+    if (entry.pair.a != pair.a)
+        turnAround(entry);
+
+    float normalImpulses[ContactManifold::maxPoints];
+    glm::vec3 tangentImpulses[ContactManifold::maxPoints];
+    for (int i = 0; i < manifold.pointCount; i++)
+    {
+        normalImpulses[i] = 0;
+        tangentImpulses[i] = glm::vec3(0);
+        for (int j = 0; j < entry.manifold.pointCount; j++)
+        {
+            if (entry.manifold.points[j].featureId == manifold.points[i].featureId)
+            {
+                normalImpulses[i] = entry.normalImpulses[j];
+                tangentImpulses[i] = entry.tangentImpulses[j];
+                warmStartedPoints++;
+                break;
+            }
+        }
+    }
+    updatedPoints += manifold.pointCount;
+
+    entry.manifold = manifold;
+    for (int i = 0; i < manifold.pointCount; i++)
+    {
+        entry.normalImpulses[i] = normalImpulses[i];
+        entry.tangentImpulses[i] = tangentImpulses[i];
+    }
+    entry.age = 0;
+    return &entry;
+}
+
+ContactCache::PairContacts *ContactCache::find(collisionTools::BodyPair pair)
+{
+    auto it = index.find(pairKey(pair));
+    return it == index.end() ? nullptr : &entries[it->second];
+}
+
+void ContactCache::clear()
+{
+    entries.clear();
+    index.clear();
+    updatedPoints = 0;
+    warmStartedPoints = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <util/CollisionInfo.h>
+#include <util/CollisionDetection.h>
+
+// contacts of the touching pairs kept between steps, so an iterative solver can start from the impulses of the last step
+//
+// Points are matched across steps by ContactPoint::featureId. Pairs that are not updated in a step age and are
+// evicted after missing more than maxAge steps, so a contact that breaks for a frame keeps its impulses.
+// (a, b) and (b, a) share an entry. A pair updated in the other order than it is stored is turned around first,
+// with the feature ids of the other order and the normal and tangent impulses flipped, so it keeps its warm start.
+class ContactCache
+{
+public:
+    struct PairContacts
+    {
+        // in the order of the last update, which the manifold and impulses refer to
+        collisionTools::BodyPair pair;
+        ContactManifold manifold;
+        // accumulated impulses of the manifold points, the solver starts from them and writes them back
+        float normalImpulses[ContactManifold::maxPoints];
+        glm::vec3 tangentImpulses[ContactManifold::maxPoints];
+        // steps since the last update, 0 if the pair is touching in the current step
+        uint32_t age = 0;
+    };
+
+    explicit ContactCache(uint32_t maxAge = 2) : maxAge(maxAge) {}
+
+    // evict the pairs that missed more than maxAge steps and age the others, call once per step before updating the pairs
+    void beginStep();
+    // store the manifold of the pair, points with a feature id of the previous manifold inherit its impulses, new points start at 0
+    // returns nullptr and leaves the pair to age if the manifold has no contact
+    // the pointer is valid until the next update or beginStep
+    PairContacts *update(collisionTools::BodyPair pair, const ContactManifold &manifold);
+    // the entry of the pair in either order, check PairContacts::pair for the order it is stored in
+    PairContacts *find(collisionTools::BodyPair pair);
+    void clear();
+
+    // all cached pairs, the ones with age 0 are touching in the current step
+    std::vector<PairContacts> &pairs() { return entries; }
+    size_t size() const { return entries.size(); }
+
+    // points updated in the current step, and how many of them inherited impulses
+    size_t updatedPoints = 0;
+    size_t warmStartedPoints = 0;
+
+    uint32_t maxAge;
+
+private:
+    static uint64_t pairKey(collisionTools::BodyPair pair);
+    static void turnAround(PairContacts &entry);
+
+    std::vector<PairContacts> entries;
+    // pair key to index into entries
+    std::unordered_map<uint64_t, uint32_t> index;
+};
@@ -0,0 +1,144 @@
+#include <util/ConvexShape.h>
+#include <cfloat>
+
+ConvexShape ConvexShape::sphere(glm::vec3 position, float radius)
+{
+    ConvexShape shape;
+    shape.type = ShapeType::Sphere;
+    shape.position = position;
+    shape.radius = radius;
+    return shape;
+}
+
+ConvexShape ConvexShape::capsule(glm::vec3 position, glm::quat rotation, float radius, float halfHeight)
+{
+    ConvexShape shape;
+    shape.type = ShapeType::Capsule;
+    shape.position = position;
+    shape.rotation = rotation;
+    shape.radius = radius;
+    shape.halfExtents = glm::vec3(0, halfHeight, 0);
+    return shape;
+}
+
+ConvexShape ConvexShape::cylinder(glm::vec3 position, glm::quat rotation, float radius, float halfHeight)
+{
+    ConvexShape shape = capsule(position, rotation, radius, halfHeight);
+    shape.type = ShapeType::Cylinder;
+    return shape;
+}
+
+ConvexShape ConvexShape::box(glm::vec3 position, glm::quat rotation, glm::vec3 halfExtents)
+{
+    ConvexShape shape;
+    shape.type = ShapeType::Box;
+    shape.position = position;
+    shape.rotation = rotation;
+    shape.halfExtents = halfExtents;
+    return shape;
+}
+
+ConvexShape ConvexShape::convexHull(glm::vec3 position, glm::quat rotation, const glm::vec3 *vertices, size_t vertexCount)
+{
+    ConvexShape shape;
+    shape.type = ShapeType::ConvexHull;
+    shape.position = position;
+    shape.rotation = rotation;
+    shape.vertices = vertices;
+    shape.vertexCount = vertexCount;
+    return shape;
+}
+
+ConvexShape ConvexShape::plane(glm::vec3 normal, float offset)
+{
+    ConvexShape shape;
+    shape.type = ShapeType::Plane;
+    shape.position = normal * offset;
+    // shortest rotation from the y axis to the normal
+    glm::vec3 up(0, 1, 0);
+    float cosine = glm::dot(up, normal);
+    if (cosine < 0)
+    {
+        // 1 + cosine loses the precision of the rotation near the negative y axis, so turn it over first and
+        // rotate from there
+        glm::quat flip(0, 1, 0, 0);
+        shape.rotation = glm::normalize(glm::quat(1 - cosine, glm::cross(-up, normal))) * flip;
+    }
+    else
+        shape.rotation = glm::normalize(glm::quat(1 + cosine, glm::cross(up, normal)));
+    return shape;
+}
+
+// +1 or -1, +1 for zero so a support point is always a point of the shape
+static float signOf(float value)
+{
+    return value < 0 ? -1.0f : 1.0f;
+}
+
+glm::vec3 ConvexShape::localSupport(glm::vec3 d) const
+{
+    switch (type)
+    {
+    case ShapeType::Sphere:
+    {
+        float length = glm::length(d);
+        return length > 0 ? d * (radius / length) : glm::vec3(radius, 0, 0);
+    }
+    case ShapeType::Capsule:
+    {
+        float length = glm::length(d);
+        glm::vec3 round = length > 0 ? d * (radius / length) : glm::vec3(radius, 0, 0);
+        return glm::vec3(0, signOf(d.y) * halfExtents.y, 0) + round;
+    }
+    case ShapeType::Cylinder:
+    {
+        float radial = glm::sqrt(d.x * d.x + d.z * d.z);
+        glm::vec3 rim = radial > 0 ? glm::vec3(d.x, 0, d.z) * (radius / radial) : glm::vec3(0);
+        return rim + glm::vec3(0, signOf(d.y) * halfExtents.y, 0);
+    }
+    case ShapeType::Box:
+        return glm::vec3(signOf(d.x), signOf(d.y), signOf(d.z)) * halfExtents;
+    case ShapeType::ConvexHull:
+    {
+        if (vertexCount == 0)
+            return glm::vec3(0);
+        size_t best = 0;
+        float bestDot = glm::dot(vertices[0], d);
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            float value = glm::dot(vertices[i], d);
+            if (value > bestDot)
+            {
+                bestDot = value;
+                best = i;
+            }
+        }
+        return vertices[best];
+    }
+    case ShapeType::Plane:
+        // a half space has no support point in most directions
+        return glm::vec3(0);
+    }
+    return glm::vec3(0);
+}
+
+glm::vec3 ConvexShape::support(glm::vec3 direction) const
+{
+    glm::vec3 localDirection = glm::conjugate(rotation) * direction;
+    return position + rotation * localSupport(localDirection);
+}
+
+AABB ConvexShape::bounds() const
+{
+    AABB result;
+    if (type == ShapeType::Plane)
+        return {glm::vec3(-FLT_MAX), glm::vec3(FLT_MAX)};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        glm::vec3 direction(0);
+        direction[axis] = 1;
+        result.max[axis] = support(direction)[axis];
+        result.min[axis] = support(-direction)[axis];
+    }
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <util/AABB.h>
+
+enum class ShapeType : uint8_t
+{
+    Sphere,
+    Capsule,
+    Cylinder,
+    Box,
+    ConvexHull,
+    // solid half space below the plane, only for the collision kernels, GJK needs bounded shapes
+    Plane,
+};
+
+constexpr size_t shapeTypeCount = 6;
+
+// convex shape placed in the world, described by its support function for GJK and EPA
+//
+// Capsules and cylinders are aligned with the local y axis. Convex hull vertices are in local space and not owned by the shape.
+// Planes have the local y axis as normal and pass through the position.
+struct ConvexShape
+{
+    ShapeType type = ShapeType::Sphere;
+    glm::vec3 position = glm::vec3(0);
+    glm::quat rotation = glm::quat(1, 0, 0, 0);
+    // sphere, capsule and cylinder
+    float radius = 0;
+    // capsule and cylinder: half the length of the axis, box: half the edge lengths
+    glm::vec3 halfExtents = glm::vec3(0);
+    const glm::vec3 *vertices = nullptr;
+    size_t vertexCount = 0;
+
+    static ConvexShape sphere(glm::vec3 position, float radius);
+    static ConvexShape capsule(glm::vec3 position, glm::quat rotation, float radius, float halfHeight);
+    static ConvexShape cylinder(glm::vec3 position, glm::quat rotation, float radius, float halfHeight);
+    static ConvexShape box(glm::vec3 position, glm::quat rotation, glm::vec3 halfExtents);
+    static ConvexShape convexHull(glm::vec3 position, glm::quat rotation, const glm::vec3 *vertices, size_t vertexCount);
+    // the points p with dot(normal, p) = offset, normal has to be normalized
+    static ConvexShape plane(glm::vec3 normal, float offset);
+
+    glm::vec3 planeNormal() const { return rotation * glm::vec3(0, 1, 0); }
+    float planeOffset() const { return glm::dot(planeNormal(), position); }
+
+    // the point of the shape farthest in the world direction, the direction does not need to be normalized
+    glm::vec3 support(glm::vec3 direction) const;
+    // support in local space, without the transform
+    glm::vec3 localSupport(glm::vec3 localDirection) const;
+
+    // unbounded for planes, keep those out of the broadphase
+    AABB bounds() const;
+};
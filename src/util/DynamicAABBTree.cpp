@@ -0,0 +1,236 @@
+#include <util/DynamicAABBTree.h>
+#include <algorithm>
+
+using collisionTools::BodyPair;
+
+int32_t DynamicAABBTree::allocateNode()
+{
+    if (freeList == nullNode)
+    {
+        nodes.emplace_back();
+        nodes.back().height = 0;
+        return static_cast<int32_t>(nodes.size() - 1);
+    }
+    // free nodes are linked through their parent index
+    int32_t index = freeList;
+    freeList = nodes[index].parent;
+    nodes[index] = Node();
+    nodes[index].height = 0;
+    return index;
+}
+
+void DynamicAABBTree::freeNode(int32_t index)
+{
+    nodes[index].parent = freeList;
+    nodes[index].height = -1;
+    freeList = index;
+}
+
+int32_t DynamicAABBTree::insert(uint32_t body, const AABB &bounds, bool isStatic)
+{
+    int32_t proxy = allocateNode();
+    Node &node = nodes[proxy];
+    node.body = body;
+    node.isStatic = isStatic;
+    node.bounds = bounds;
+    // static bodies do not move, so they do not need room to move
+    node.fatBounds = isStatic ? bounds : bounds.expanded(margin);
+    insertLeaf(proxy);
+    leafCount++;
+    return proxy;
+}
+
+void DynamicAABBTree::remove(int32_t proxy)
+{
+    removeLeaf(proxy);
+    freeNode(proxy);
+    leafCount--;
+}
+
+bool DynamicAABBTree::update(int32_t proxy, const AABB &bounds)
+{
+    Node &node = nodes[proxy];
+    node.bounds = bounds;
+    if (node.fatBounds.contains(bounds))
+        return false;
+    removeLeaf(proxy);
+    nodes[proxy].fatBounds = nodes[proxy].isStatic ? bounds : bounds.expanded(margin);
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicAABBTree::clear()
+{
+    nodes.clear();
+    root = nullNode;
+    freeList = nullNode;
+    leafCount = 0;
+    pairs.clear();
+}
+
+void DynamicAABBTree::insertLeaf(int32_t leaf)
+{
+    if (root == nullNode)
+    {
+        root = leaf;
+        nodes[leaf].parent = nullNode;
+        return;
+    }
+
+    // walk down to the sibling that adds the least surface area to the tree
+    AABB leafBounds = nodes[leaf].fatBounds;
+    int32_t index = root;
+    while (!nodes[index].isLeaf())
+    {
+        const Node &node = nodes[index];
+        float area = node.fatBounds.surfaceArea();
+        float combinedArea = node.fatBounds.merged(leafBounds).surfaceArea();
+        // cost of a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+        // cost the leaf adds to all ancestors when pushed further down
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCost[2];
+        int32_t children[2] = {node.child1, node.child2};
+        for (int i = 0; i < 2; i++)
+        {
+            const Node &child = nodes[children[i]];
+            float mergedArea = child.fatBounds.merged(leafBounds).surfaceArea();
+            childCost[i] = (child.isLeaf() ? mergedArea : mergedArea - child.fatBounds.surfaceArea()) + inheritanceCost;
+        }
+        if (cost < childCost[0] && cost < childCost[1])
+            break;
+        index = childCost[0] < childCost[1] ? children[0] : children[1];
+    }
+
+    int32_t sibling = index;
+    int32_t oldParent = nodes[sibling].parent;
+    int32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].fatBounds = leafBounds.merged(nodes[sibling].fatBounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent == nullNode)
+        root = newParent;
+    else if (nodes[oldParent].child1 == sibling)
+        nodes[oldParent].child1 = newParent;
+    else
+        nodes[oldParent].child2 = newParent;
+
+    refitAncestors(nodes[leaf].parent);
+}
+
+void DynamicAABBTree::removeLeaf(int32_t leaf)
+{
+    if (leaf == root)
+    {
+        root = nullNode;
+        return;
+    }
+    int32_t parent = nodes[leaf].parent;
+    int32_t grandParent = nodes[parent].parent;
+    int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    // the sibling takes the place of the parent
+    if (grandParent == nullNode)
+    {
+        root = sibling;
+        nodes[sibling].parent = nullNode;
+        freeNode(parent);
+        return;
+    }
+    if (nodes[grandParent].child1 == parent)
+        nodes[grandParent].child1 = sibling;
+    else
+        nodes[grandParent].child2 = sibling;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    refitAncestors(grandParent);
+}
+
+void DynamicAABBTree::refitAncestors(int32_t index)
+{
+    while (index != nullNode)
+    {
+        index = balance(index);
+        Node &node = nodes[index];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.fatBounds = nodes[node.child1].fatBounds.merged(nodes[node.child2].fatBounds);
+        index = node.parent;
+    }
+}
+
+int32_t DynamicAABBTree::balance(int32_t indexA)
+{
+    if (nodes[indexA].isLeaf() || nodes[indexA].height < 2)
+        return indexA;
+
+    int32_t indexB = nodes[indexA].child1;
+    int32_t indexC = nodes[indexA].child2;
+    int32_t heightDifference = nodes[indexC].height - nodes[indexB].height;
+    if (heightDifference >= -1 && heightDifference <= 1)
+        return indexA;
+
+    // rotate the higher child up: it takes the place of A, keeps its taller child and hands its lower child to A,
+    // which keeps its other child. Like an AVL rotation, this reduces the height difference to at most one.
+    bool rotateC = heightDifference > 1;
+    int32_t indexUp = rotateC ? indexC : indexB;
+    int32_t indexOther = rotateC ? indexB : indexC;
+    Node &up = nodes[indexUp];
+    int32_t indexF = up.child1;
+    int32_t indexG = up.child2;
+    int32_t indexTaller = nodes[indexF].height > nodes[indexG].height ? indexF : indexG;
+    int32_t indexLower = indexTaller == indexF ? indexG : indexF;
+
+    // up replaces A at its parent
+    up.parent = nodes[indexA].parent;
+    if (up.parent == nullNode)
+        root = indexUp;
+    else if (nodes[up.parent].child1 == indexA)
+        nodes[up.parent].child1 = indexUp;
+    else
+        nodes[up.parent].child2 = indexUp;
+    up.child1 = indexA;
+    up.child2 = indexTaller;
+    nodes[indexA].parent = indexUp;
+
+    // A keeps its other child and adopts the lower child of up
+    Node &a = nodes[indexA];
+    if (rotateC)
+        a.child2 = indexLower;
+    else
+        a.child1 = indexLower;
+    nodes[indexLower].parent = indexA;
+    a.fatBounds = nodes[indexOther].fatBounds.merged(nodes[indexLower].fatBounds);
+    a.height = 1 + std::max(nodes[indexOther].height, nodes[indexLower].height);
+    up.fatBounds = a.fatBounds.merged(nodes[indexTaller].fatBounds);
+    up.height = 1 + std::max(a.height, nodes[indexTaller].height);
+    return indexUp;
+}
+
+const std::vector<BodyPair> &DynamicAABBTree::findPairs()
+{
+    pairs.clear();
+    for (int32_t proxy = 0; proxy < static_cast<int32_t>(nodes.size()); proxy++)
+    {
+        const Node &node = nodes[proxy];
+        // only dynamic leaves query, so static bodies never meet each other
+        if (node.height != 0 || node.isStatic)
+            continue;
+        query(node.fatBounds, [&](int32_t other)
+              {
+                  const Node &otherNode = nodes[other];
+                  if (other == proxy || !node.bounds.overlaps(otherNode.bounds))
+                      return;
+                  // pairs of two dynamic bodies are found from both sides, keep one
+                  if (!otherNode.isStatic && otherNode.body < node.body)
+                      return;
+                  pairs.push_back({std::min(node.body, otherNode.body), std::max(node.body, otherNode.body)}); });
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const BodyPair &p1, const BodyPair &p2)
+              { return p1.a < p2.a || (p1.a == p2.a && p1.b < p2.b); });
+    return pairs;
+}
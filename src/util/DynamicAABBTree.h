@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <util/AABB.h>
+#include <util/CollisionDetection.h>
+
+// dynamic bounding volume hierarchy broadphase, for scenes that mix tiny and huge bodies
+//
+// Leaves store the bounds enlarged by `margin` ("fat" bounds), so a body that moves a little stays inside them
+// and does not touch the tree at all. Only when a body leaves its fat bounds, its leaf is removed and reinserted
+// at the cheapest place by surface area, refitting the bounds of its ancestors and rebalancing them with tree rotations.
+class DynamicAABBTree
+{
+public:
+    static constexpr int32_t nullNode = -1;
+
+    explicit DynamicAABBTree(float margin = 0.1f) : margin(margin) {}
+
+    // returns the proxy id of the new leaf, static bodies are never paired with other static bodies
+    int32_t insert(uint32_t body, const AABB &bounds, bool isStatic = false);
+    void remove(int32_t proxy);
+    // set the tight bounds of a leaf, returns true if the leaf left its fat bounds and was reinserted
+    bool update(int32_t proxy, const AABB &bounds);
+    void clear();
+
+    // all pairs of leaves with overlapping tight bounds and at least one dynamic body, by body id, a < b, in ascending order
+    const std::vector<collisionTools::BodyPair> &findPairs();
+
+    // call callback(proxy) for every leaf whose fat bounds overlap the given bounds
+    // inlineStackSize only needs changing to test the heap fallback of the traversal stack with a small tree
+    template <size_t inlineStackSize = 256, typename Callback>
+    void query(const AABB &bounds, Callback &&callback) const
+    {
+        if (root == nullNode)
+            return;
+        // the stack stays below twice the height, which the rotations keep small, so it rarely leaves the inline buffer
+        static_assert(inlineStackSize >= 1, "the root has to fit into the inline stack");
+        int32_t inlineStack[inlineStackSize];
+        std::vector<int32_t> heapStack;
+        int32_t *stack = inlineStack;
+        size_t capacity = inlineStackSize;
+        size_t count = 0;
+        stack[count++] = root;
+        while (count > 0)
+        {
+            int32_t index = stack[--count];
+            const Node &node = nodes[index];
+            if (!node.fatBounds.overlaps(bounds))
+                continue;
+            if (node.isLeaf())
+            {
+                callback(index);
+                continue;
+            }
+            if (count + 2 > capacity)
+            {
+                // copy from the inline buffer only on the first switch, resize keeps the heap contents
+                if (stack == inlineStack)
+                    heapStack.assign(stack, stack + count);
+                heapStack.resize(capacity * 2);
+                stack = heapStack.data();
+                capacity = heapStack.size();
+            }
+            stack[count++] = node.child1;
+            stack[count++] = node.child2;
+        }
+    }
+
+    uint32_t body(int32_t proxy) const { return nodes[proxy].body; }
+    const AABB &bounds(int32_t proxy) const { return nodes[proxy].bounds; }
+    const AABB &fatBounds(int32_t proxy) const { return nodes[proxy].fatBounds; }
+    size_t size() const { return leafCount; }
+    // height of the root, 0 for a single leaf
+    int height() const { return root == nullNode ? 0 : nodes[root].height; }
+
+    float margin;
+
+private:
+    struct Node
+    {
+        AABB fatBounds;
+        // tight bounds, leaves only
+        AABB bounds;
+        int32_t parent = nullNode;
+        int32_t child1 = nullNode;
+        int32_t child2 = nullNode;
+        // 0 for leaves, -1 for free nodes
+        int32_t height = -1;
+        uint32_t body = 0;
+        bool isStatic = false;
+
+        bool isLeaf() const { return child1 == nullNode; }
+    };
+
+    int32_t allocateNode();
+    void freeNode(int32_t index);
+    void insertLeaf(int32_t leaf);
+    void removeLeaf(int32_t leaf);
+    // recompute bounds and heights from index up to the root, rotating unbalanced nodes
+    void refitAncestors(int32_t index);
+    int32_t balance(int32_t index);
+
+    std::vector<Node> nodes;
+    int32_t root = nullNode;
+    int32_t freeList = nullNode;
+    size_t leafCount = 0;
+    std::vector<collisionTools::BodyPair> pairs;
+};
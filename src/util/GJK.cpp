@@ -0,0 +1,508 @@
+#include <util/GJK.h>
+#include <glm/gtx/norm.hpp>
+#include <cfloat>
+#include <algorithm>
+
+namespace collisionTools
+{
+    using vec3 = glm::vec3;
+    using dvec3 = glm::dvec3;
+
+    static constexpr int gjkMaxIterations = 64;
+    // relative progress below which GJK has converged
+    static constexpr float gjkTolerance = 1e-5f;
+    static constexpr int epaMaxIterations = 128;
+    // EPA stops once the support point is less than this far beyond the closest face
+    static constexpr float epaTolerance = 1e-4f;
+    static constexpr int epaMaxVertices = 128;
+    static constexpr int epaMaxFaces = 256;
+
+    // the rotation as a matrix once per query, instead of rotating by the quaternion twice per support call
+    struct PreparedShape
+    {
+        const ConvexShape &shape;
+        glm::mat3 rotation;
+        glm::mat3 inverseRotation;
+
+        explicit PreparedShape(const ConvexShape &shape)
+            : shape(shape), rotation(glm::mat3_cast(shape.rotation)), inverseRotation(glm::transpose(rotation)) {}
+
+        vec3 support(vec3 direction) const
+        {
+            return shape.position + rotation * shape.localSupport(inverseRotation * direction);
+        }
+    };
+
+    static SupportPoint supportPoint(const PreparedShape &a, const PreparedShape &b, vec3 direction)
+    {
+        SupportPoint p;
+        p.a = a.support(direction);
+        p.b = b.support(-direction);
+        p.w = p.a - p.b;
+        return p;
+    }
+
+    static void keep(Simplex &simplex, int i0, int i1 = -1, int i2 = -1)
+    {
+        SupportPoint points[3] = {simplex.points[i0]};
+        int count = 1;
+        if (i1 >= 0)
+            points[count++] = simplex.points[i1];
+        if (i2 >= 0)
+            points[count++] = simplex.points[i2];
+        for (int i = 0; i < count; i++)
+            simplex.points[i] = points[i];
+        simplex.count = count;
+    }
+
+    // closest point of segment or triangle to the origin (Ericson, Real-Time Collision Detection 5.1.5),
+    // reduces the simplex to the vertices of the feature the point lies on, weights are the barycentric coordinates
+    static dvec3 closestOnTriangle(Simplex &simplex, double *weights)
+    {
+        dvec3 a(simplex.points[0].w), b(simplex.points[1].w), c(simplex.points[2].w);
+        dvec3 ab = b - a, ac = c - a;
+        double d1 = glm::dot(ab, -a), d2 = glm::dot(ac, -a);
+        if (d1 <= 0 && d2 <= 0)
+        {
+            keep(simplex, 0);
+            weights[0] = 1;
+            return a;
+        }
+        double d3 = glm::dot(ab, -b), d4 = glm::dot(ac, -b);
+        if (d3 >= 0 && d4 <= d3)
+        {
+            keep(simplex, 1);
+            weights[0] = 1;
+            return b;
+        }
+        double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        {
+            double t = d1 / (d1 - d3);
+            keep(simplex, 0, 1);
+            weights[0] = 1 - t;
+            weights[1] = t;
+            return a + ab * t;
+        }
+        double d5 = glm::dot(ab, -c), d6 = glm::dot(ac, -c);
+        if (d6 >= 0 && d5 <= d6)
+        {
+            keep(simplex, 2);
+            weights[0] = 1;
+            return c;
+        }
+        double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        {
+            double t = d2 / (d2 - d6);
+            keep(simplex, 0, 2);
+            weights[0] = 1 - t;
+            weights[1] = t;
+            return a + ac * t;
+        }
+        double va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        {
+            double t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            keep(simplex, 1, 2);
+            weights[0] = 1 - t;
+            weights[1] = t;
+            return b + (c - b) * t;
+        }
+        double denominator = 1.0 / (va + vb + vc);
+        double v = vb * denominator, w = vc * denominator;
+        weights[0] = 1 - v - w;
+        weights[1] = v;
+        weights[2] = w;
+        return a + ab * v + ac * w;
+    }
+
+    static dvec3 closestOnSegment(Simplex &simplex, double *weights)
+    {
+        dvec3 a(simplex.points[0].w), b(simplex.points[1].w);
+        dvec3 ab = b - a;
+        double lengthSquared = glm::dot(ab, ab);
+        double t = lengthSquared > 0 ? glm::dot(-a, ab) / lengthSquared : 0;
+        if (t <= 0)
+        {
+            keep(simplex, 0);
+            weights[0] = 1;
+            return a;
+        }
+        if (t >= 1)
+        {
+            keep(simplex, 1);
+            weights[0] = 1;
+            return b;
+        }
+        weights[0] = 1 - t;
+        weights[1] = t;
+        return a + ab * t;
+    }
+
+    // the closest point of every face the origin is in front of, the origin is inside if there is none
+    static dvec3 closestOnTetrahedron(Simplex &simplex, double *weights, bool &inside)
+    {
+        static const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+        inside = true;
+        double bestDistance = DBL_MAX;
+        dvec3 best(0);
+        Simplex bestSimplex;
+        double bestWeights[3] = {};
+        for (const auto &face : faces)
+        {
+            dvec3 a(simplex.points[face[0]].w);
+            dvec3 normal = glm::cross(dvec3(simplex.points[face[1]].w) - a, dvec3(simplex.points[face[2]].w) - a);
+            double signOrigin = glm::dot(-a, normal);
+            double signOpposite = glm::dot(dvec3(simplex.points[face[3]].w) - a, normal);
+            // a flat tetrahedron has no inside, all faces are candidates then
+            if (signOrigin * signOpposite > 0 && signOpposite * signOpposite > 1e-12f)
+                continue;
+            inside = false;
+            Simplex triangle;
+            triangle.points[0] = simplex.points[face[0]];
+            triangle.points[1] = simplex.points[face[1]];
+            triangle.points[2] = simplex.points[face[2]];
+            triangle.count = 3;
+            double triangleWeights[3];
+            dvec3 point = closestOnTriangle(triangle, triangleWeights);
+            double distance = glm::length2(point);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                best = point;
+                bestSimplex = triangle;
+                std::copy(triangleWeights, triangleWeights + 3, bestWeights);
+            }
+        }
+        if (!inside)
+        {
+            simplex = bestSimplex;
+            std::copy(bestWeights, bestWeights + 3, weights);
+        }
+        return best;
+    }
+
+    static GJKResult runGJK(const PreparedShape &a, const PreparedShape &b, bool stopWhenSeparated)
+    {
+        GJKResult result;
+        vec3 direction = a.shape.position - b.shape.position;
+        if (glm::length2(direction) == 0)
+            direction = vec3(1, 0, 0);
+        Simplex &simplex = result.simplex;
+        simplex.points[0] = supportPoint(a, b, -direction);
+        simplex.count = 1;
+        double weights[4] = {1};
+        dvec3 v(simplex.points[0].w);
+        double lastDistance = DBL_MAX;
+
+        for (result.iterations = 0; result.iterations < gjkMaxIterations; result.iterations++)
+        {
+            double distance = glm::length2(v);
+            if (distance <= gjkTolerance * gjkTolerance)
+            {
+                // touching
+                result.intersecting = true;
+                return result;
+            }
+            // support of A - B towards the origin
+            SupportPoint w = supportPoint(a, b, -vec3(v));
+            double progress = glm::dot(v, dvec3(w.w));
+            if (stopWhenSeparated && progress > 0)
+                break;
+            // no point of A - B is much closer to the origin than v, or rounding stopped the progress
+            if (distance - progress <= gjkTolerance * distance || distance >= lastDistance)
+                break;
+            lastDistance = distance;
+
+            simplex.points[simplex.count++] = w;
+            Simplex previous = simplex;
+            double previousWeights[4];
+            std::copy(weights, weights + 4, previousWeights);
+            bool inside = false;
+            if (simplex.count == 2)
+                v = closestOnSegment(simplex, weights);
+            else if (simplex.count == 3)
+                v = closestOnTriangle(simplex, weights);
+            else
+                v = closestOnTetrahedron(simplex, weights, inside);
+            if (inside)
+            {
+                result.intersecting = true;
+                return result;
+            }
+            if (glm::length2(v) >= distance)
+            {
+                // no progress, keep the last simplex
+                simplex = previous;
+                simplex.count--;
+                std::copy(previousWeights, previousWeights + 4, weights);
+                v = dvec3(0);
+                for (int i = 0; i < simplex.count; i++)
+                    v += dvec3(simplex.points[i].w) * weights[i];
+                // no plane along v separates the shapes either, they touch within rounding
+                if (progress <= 0)
+                {
+                    result.intersecting = true;
+                    return result;
+                }
+                break;
+            }
+        }
+
+        result.distance = static_cast<float>(glm::length(v));
+        dvec3 pointA(0), pointB(0);
+        for (int i = 0; i < simplex.count; i++)
+        {
+            pointA += dvec3(simplex.points[i].a) * weights[i];
+            pointB += dvec3(simplex.points[i].b) * weights[i];
+        }
+        result.pointA = vec3(pointA);
+        result.pointB = vec3(pointB);
+        return result;
+    }
+
+    GJKResult gjkDistance(const ConvexShape &a, const ConvexShape &b)
+    {
+        return runGJK(PreparedShape(a), PreparedShape(b), false);
+    }
+
+    namespace
+    {
+        struct Face
+        {
+            int vertices[3];
+            vec3 normal;
+            // distance of the face plane from the origin
+            float distance;
+        };
+
+        struct Edge
+        {
+            int from, to;
+        };
+
+        struct Polytope
+        {
+            SupportPoint vertices[epaMaxVertices];
+            int vertexCount = 0;
+            Face faces[epaMaxFaces];
+            int faceCount = 0;
+
+            bool addFace(int i0, int i1, int i2)
+            {
+                if (faceCount == epaMaxFaces)
+                    return false;
+                Face &face = faces[faceCount++];
+                face.vertices[0] = i0;
+                face.vertices[1] = i1;
+                face.vertices[2] = i2;
+                vec3 a = vertices[i0].w;
+                vec3 normal = glm::cross(vertices[i1].w - a, vertices[i2].w - a);
+                float length = glm::length(normal);
+                if (length > 0)
+                {
+                    face.normal = normal / length;
+                    face.distance = glm::dot(face.normal, a);
+                }
+                else
+                {
+                    // degenerate, never the closest face
+                    face.normal = vec3(0);
+                    face.distance = FLT_MAX;
+                }
+                return true;
+            }
+        };
+    }
+
+    // grow the simplex to a tetrahedron around the origin, fails for shapes that are flat in some direction or only touch
+    static bool buildTetrahedron(const PreparedShape &a, const PreparedShape &b, Simplex &simplex)
+    {
+        static const vec3 directions[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        const float epsilon = 1e-6f;
+        if (simplex.count == 1)
+        {
+            for (const vec3 &direction : directions)
+            {
+                SupportPoint p = supportPoint(a, b, direction);
+                if (glm::length2(p.w - simplex.points[0].w) > epsilon)
+                {
+                    simplex.points[simplex.count++] = p;
+                    break;
+                }
+            }
+        }
+        if (simplex.count == 2)
+        {
+            vec3 line = simplex.points[1].w - simplex.points[0].w;
+            // any direction perpendicular to the line, and then the same rotated around it
+            vec3 axis = glm::abs(line.x) < glm::abs(line.y) ? vec3(1, 0, 0) : vec3(0, 1, 0);
+            vec3 side = glm::normalize(glm::cross(line, axis));
+            glm::quat rotation = glm::angleAxis(glm::radians(60.0f), glm::normalize(line));
+            for (int i = 0; i < 6; i++)
+            {
+                SupportPoint p = supportPoint(a, b, side);
+                if (glm::length2(glm::cross(p.w - simplex.points[0].w, line)) > epsilon * glm::length2(line))
+                {
+                    simplex.points[simplex.count++] = p;
+                    break;
+                }
+                side = rotation * side;
+            }
+        }
+        if (simplex.count == 3)
+        {
+            vec3 normal = glm::cross(simplex.points[1].w - simplex.points[0].w, simplex.points[2].w - simplex.points[0].w);
+            vec3 sides[2] = {normal, -normal};
+            for (vec3 direction : sides)
+            {
+                SupportPoint p = supportPoint(a, b, direction);
+                if (glm::abs(glm::dot(p.w - simplex.points[0].w, normal)) > epsilon * glm::length(normal))
+                {
+                    simplex.points[simplex.count++] = p;
+                    break;
+                }
+            }
+        }
+        return simplex.count == 4;
+    }
+
+    static EPAResult runEPA(const PreparedShape &a, const PreparedShape &b, const Simplex &start)
+    {
+        EPAResult result;
+        Simplex simplex = start;
+        if (!buildTetrahedron(a, b, simplex))
+            return result;
+
+        Polytope polytope;
+        for (int i = 0; i < 4; i++)
+            polytope.vertices[i] = simplex.points[i];
+        polytope.vertexCount = 4;
+        vec3 centroid = (simplex.points[0].w + simplex.points[1].w + simplex.points[2].w + simplex.points[3].w) * 0.25f;
+        static const int faces[4][3] = {{0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2}};
+        for (const auto &face : faces)
+        {
+            // wind every face so its normal points away from the inside
+            vec3 normal = glm::cross(simplex.points[face[1]].w - simplex.points[face[0]].w, simplex.points[face[2]].w - simplex.points[face[0]].w);
+            if (glm::dot(normal, centroid - simplex.points[face[0]].w) > 0)
+                polytope.addFace(face[0], face[2], face[1]);
+            else
+                polytope.addFace(face[0], face[1], face[2]);
+        }
+
+        int closest = 0;
+        for (result.iterations = 0; result.iterations < epaMaxIterations; result.iterations++)
+        {
+            closest = 0;
+            for (int i = 1; i < polytope.faceCount; i++)
+                if (polytope.faces[i].distance < polytope.faces[closest].distance)
+                    closest = i;
+            const Face &face = polytope.faces[closest];
+            SupportPoint w = supportPoint(a, b, face.normal);
+            if (glm::dot(w.w, face.normal) - face.distance < epaTolerance || polytope.vertexCount == epaMaxVertices)
+                break;
+
+            // remove the faces the new vertex sees, the edges they do not share form the horizon
+            int newVertex = polytope.vertexCount++;
+            polytope.vertices[newVertex] = w;
+            Edge horizon[epaMaxFaces * 3];
+            int edgeCount = 0;
+            for (int i = 0; i < polytope.faceCount;)
+            {
+                Face &visible = polytope.faces[i];
+                if (glm::dot(visible.normal, w.w - polytope.vertices[visible.vertices[0]].w) <= 0)
+                {
+                    i++;
+                    continue;
+                }
+                for (int e = 0; e < 3; e++)
+                {
+                    Edge edge{visible.vertices[e], visible.vertices[(e + 1) % 3]};
+                    bool shared = false;
+                    for (int j = 0; j < edgeCount; j++)
+                    {
+                        if (horizon[j].from == edge.to && horizon[j].to == edge.from)
+                        {
+                            horizon[j] = horizon[--edgeCount];
+                            shared = true;
+                            break;
+                        }
+                    }
+                    if (!shared)
+                        horizon[edgeCount++] = edge;
+                }
+                visible = polytope.faces[--polytope.faceCount];
+            }
+            bool full = false;
+            for (int j = 0; j < edgeCount && !full; j++)
+                full = !polytope.addFace(horizon[j].from, horizon[j].to, newVertex);
+            if (full || polytope.faceCount == 0)
+                break;
+        }
+
+        if (polytope.faceCount == 0)
+            return result;
+        closest = 0;
+        for (int i = 1; i < polytope.faceCount; i++)
+            if (polytope.faces[i].distance < polytope.faces[closest].distance)
+                closest = i;
+        const Face &face = polytope.faces[closest];
+        if (face.distance == FLT_MAX)
+            return result;
+        result.valid = true;
+        result.normal = face.normal;
+        result.depth = face.distance;
+
+        // barycentric coordinates of the projected origin on the closest face
+        Simplex triangle;
+        for (int i = 0; i < 3; i++)
+            triangle.points[i] = polytope.vertices[face.vertices[i]];
+        vec3 p = face.normal * face.distance;
+        vec3 v0 = triangle.points[1].w - triangle.points[0].w, v1 = triangle.points[2].w - triangle.points[0].w, v2 = p - triangle.points[0].w;
+        float d00 = glm::dot(v0, v0), d01 = glm::dot(v0, v1), d11 = glm::dot(v1, v1);
+        float d20 = glm::dot(v2, v0), d21 = glm::dot(v2, v1);
+        float denominator = d00 * d11 - d01 * d01;
+        float v = denominator != 0 ? (d11 * d20 - d01 * d21) / denominator : 0;
+        float u = denominator != 0 ? (d00 * d21 - d01 * d20) / denominator : 0;
+        float weights[3] = {1 - v - u, v, u};
+        for (int i = 0; i < 3; i++)
+        {
+            result.pointA += triangle.points[i].a * weights[i];
+            result.pointB += triangle.points[i].b * weights[i];
+        }
+        return result;
+    }
+
+    EPAResult epaPenetration(const ConvexShape &a, const ConvexShape &b, const Simplex &simplex)
+    {
+        return runEPA(PreparedShape(a), PreparedShape(b), simplex);
+    }
+
+    CollisionInfo checkCollisionGJK(const ConvexShape &a, const ConvexShape &b)
+    {
+        CollisionInfo info;
+        info.isColliding = false;
+        PreparedShape preparedA(a), preparedB(b);
+        GJKResult gjk = runGJK(preparedA, preparedB, true);
+        if (!gjk.intersecting)
+            return info;
+        EPAResult epa = runEPA(preparedA, preparedB, gjk.simplex);
+        info.isColliding = true;
+        if (epa.valid)
+        {
+            info.normalWorld = -epa.normal;
+            info.depth = epa.depth;
+            info.collisionPointWorld = (epa.pointA + epa.pointB) * 0.5f;
+        }
+        else
+        {
+            // touching without overlap
+            vec3 toCenter = b.position - a.position;
+            info.normalWorld = glm::length2(toCenter) > 0 ? -glm::normalize(toCenter) : vec3(0, -1, 0);
+            info.depth = 0;
+            info.collisionPointWorld = gjk.simplex.points[0].a;
+        }
+        return info;
+    }
+}
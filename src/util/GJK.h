@@ -0,0 +1,55 @@
+#pragma once
+#include <util/ConvexShape.h>
+#include <util/CollisionInfo.h>
+
+// GJK distance and EPA penetration depth for any pair of convex shapes with a support function
+//
+// Both work on the Minkowski difference A - B, which contains the origin exactly if the shapes intersect.
+// GJK iterates a simplex towards the point of A - B closest to the origin. If the shapes intersect, EPA expands the
+// final simplex into a polytope until its face closest to the origin lies on the surface of A - B.
+namespace collisionTools
+{
+    // point of the Minkowski difference with the points of A and B it is made of
+    struct SupportPoint
+    {
+        glm::vec3 w, a, b;
+    };
+
+    struct Simplex
+    {
+        SupportPoint points[4];
+        int count = 0;
+    };
+
+    struct GJKResult
+    {
+        bool intersecting = false;
+        // distance and closest points of the shapes, only set if they do not intersect
+        float distance = 0;
+        glm::vec3 pointA = glm::vec3(0), pointB = glm::vec3(0);
+        // the simplex EPA starts from if the shapes intersect
+        Simplex simplex;
+        int iterations = 0;
+    };
+
+    struct EPAResult
+    {
+        // false if no polytope could be built, e.g. for shapes that only touch
+        bool valid = false;
+        // direction from A to B along which the shapes overlap least, and by how much
+        glm::vec3 normal = glm::vec3(0);
+        float depth = 0;
+        // deepest points of A inside B and of B inside A
+        glm::vec3 pointA = glm::vec3(0), pointB = glm::vec3(0);
+        int iterations = 0;
+    };
+
+    GJKResult gjkDistance(const ConvexShape &a, const ConvexShape &b);
+
+    // penetration of intersecting shapes, starting from the simplex of gjkDistance
+    EPAResult epaPenetration(const ConvexShape &a, const ConvexShape &b, const Simplex &simplex);
+
+    // same conventions as checkCollisionSAT, the point is halfway between the deepest points of the two shapes
+    // GJK stops as soon as it finds a separating plane, so separated pairs do not need the full distance query
+    CollisionInfo checkCollisionGJK(const ConvexShape &a, const ConvexShape &b);
+}
@@ -0,0 +1,279 @@
+#include <util/SceneQuery.h>
+#include <algorithm>
+#include <numeric>
+#include <glm/gtx/norm.hpp>
+
+using collisionTools::BodyTransforms;
+
+void SceneQuery::build(const BodyTransforms &bodies)
+{
+    bodyCount = bodies.size();
+    nodes.clear();
+    groups.clear();
+    if (bodyCount == 0)
+        return;
+    boxes.resize(bodyCount);
+    bodyBounds.resize(bodyCount);
+    centers.resize(bodyCount);
+    for (size_t i = 0; i < bodyCount; i++)
+    {
+        boxes[i] = collisionTools::makeOBB(bodies.worldFromObj(i));
+        bodyBounds[i] = collisionTools::computeAABB(boxes[i]);
+        centers[i] = boxes[i].center;
+    }
+    std::vector<uint32_t> order(bodyCount);
+    std::iota(order.begin(), order.end(), 0);
+    // a full binary tree over ceil(n / leafSize) leaves
+    nodes.reserve(2 * (bodyCount / leafSize + 1));
+    groups.reserve(bodyCount / leafSize + 1);
+    buildNode(order.data(), static_cast<uint32_t>(bodyCount));
+}
+
+uint32_t SceneQuery::buildNode(uint32_t *first, uint32_t count)
+{
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+    AABB bounds = bodyBounds[first[0]];
+    AABB centerBounds{centers[first[0]], centers[first[0]]};
+    for (uint32_t i = 1; i < count; i++)
+    {
+        bounds = bounds.merged(bodyBounds[first[i]]);
+        centerBounds = centerBounds.merged({centers[first[i]], centers[first[i]]});
+    }
+    nodes[index].bounds = bounds;
+
+    if (count <= leafSize)
+    {
+        BoxGroup group{};
+        for (uint32_t j = 0; j < count; j++)
+        {
+            const collisionTools::OBB &box = boxes[first[j]];
+            group.centerX[j] = box.center.x;
+            group.centerY[j] = box.center.y;
+            group.centerZ[j] = box.center.z;
+            for (int i = 0; i < 3; i++)
+            {
+                group.axisX[i][j] = box.axes[i].x;
+                group.axisY[i][j] = box.axes[i].y;
+                group.axisZ[i][j] = box.axes[i].z;
+                group.halfExtents[i][j] = box.halfExtents[i];
+            }
+            group.bounds[j] = bodyBounds[first[j]];
+            group.bodies[j] = first[j];
+        }
+        nodes[index].group = static_cast<uint32_t>(groups.size());
+        nodes[index].count = count;
+        groups.push_back(group);
+        return index;
+    }
+
+    // median split along the longest axis of the centers
+    glm::vec3 extent = centerBounds.size();
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    uint32_t half = count / 2;
+    std::nth_element(first, first + half, first + count, [&](uint32_t a, uint32_t b)
+                     { return centers[a][axis] < centers[b][axis]; });
+    nodes[index].count = 0;
+    buildNode(first, half);
+    uint32_t second = buildNode(first + half, count - half);
+    nodes[index].secondChild = second;
+    return index;
+}
+
+glm::vec3 SceneQuery::groupAxis(const BoxGroup &group, int lane, int axis)
+{
+    return glm::vec3(group.axisX[axis][lane], group.axisY[axis][lane], group.axisZ[axis][lane]);
+}
+
+glm::vec3 SceneQuery::groupCenter(const BoxGroup &group, int lane)
+{
+    return glm::vec3(group.centerX[lane], group.centerY[lane], group.centerZ[lane]);
+}
+
+void SceneQuery::rayGroup(const BoxGroup &group, uint32_t count, const Ray &ray, float *entry)
+{
+    // the same operations in every lane and no early exits, so the loops can be vectorized
+    float tMin[leafSize], tMax[leafSize];
+    for (int j = 0; j < leafSize; j++)
+    {
+        tMin[j] = 0;
+        tMax[j] = ray.maxDistance;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < leafSize; j++)
+        {
+            float toCenterX = group.centerX[j] - ray.origin.x;
+            float toCenterY = group.centerY[j] - ray.origin.y;
+            float toCenterZ = group.centerZ[j] - ray.origin.z;
+            // the ray in the frame of the box, along its axis i
+            float e = group.axisX[i][j] * toCenterX + group.axisY[i][j] * toCenterY + group.axisZ[i][j] * toCenterZ;
+            float f = group.axisX[i][j] * ray.direction.x + group.axisY[i][j] * ray.direction.y + group.axisZ[i][j] * ray.direction.z;
+            // a ray parallel to the slab gets infinite distances, which miss unless the origin is between the planes
+            float inverse = 1.0f / f;
+            float t1 = (e - group.halfExtents[i][j]) * inverse;
+            float t2 = (e + group.halfExtents[i][j]) * inverse;
+            tMin[j] = std::max(tMin[j], std::min(t1, t2));
+            tMax[j] = std::min(tMax[j], std::max(t1, t2));
+        }
+    }
+    for (uint32_t j = 0; j < leafSize; j++)
+        entry[j] = (j < count && tMin[j] <= tMax[j]) ? tMin[j] : FLT_MAX;
+}
+
+// entry distance of the ray into the bounds, FLT_MAX if it misses them within maxDistance
+static float rayBounds(const AABB &bounds, const glm::vec3 &origin, const glm::vec3 &inverseDirection, float maxDistance)
+{
+    glm::vec3 t1 = (bounds.min - origin) * inverseDirection;
+    glm::vec3 t2 = (bounds.max - origin) * inverseDirection;
+    // not near and far, windows.h defines those as macros
+    glm::vec3 entries = glm::min(t1, t2), exits = glm::max(t1, t2);
+    float tMin = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+    float tMax = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+    return tMin <= tMax ? tMin : FLT_MAX;
+}
+
+RayHit SceneQuery::rayCast(const Ray &ray) const
+{
+    RayHit result;
+    if (nodes.empty())
+        return result;
+    glm::vec3 inverseDirection = 1.0f / ray.direction;
+    float closest = ray.maxDistance;
+    int hitLane = -1;
+    uint32_t hitGroup = 0;
+
+    // the height of a median split tree is about log2(n / leafSize), 64 entries are plenty
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        uint32_t index = stack[--stackSize];
+        const Node &node = nodes[index];
+        if (rayBounds(node.bounds, ray.origin, inverseDirection, closest) == FLT_MAX)
+            continue;
+        if (node.isLeaf())
+        {
+            Ray clipped = ray;
+            clipped.maxDistance = closest;
+            float entry[leafSize];
+            rayGroup(groups[node.group], node.count, clipped, entry);
+            for (int j = 0; j < leafSize; j++)
+            {
+                if (entry[j] <= closest && entry[j] != FLT_MAX)
+                {
+                    closest = entry[j];
+                    hitLane = j;
+                    hitGroup = node.group;
+                }
+            }
+            continue;
+        }
+        // visit the nearer child first, so the farther one can be skipped once something closer was hit
+        uint32_t first = index + 1, second = node.secondChild;
+        float firstEntry = rayBounds(nodes[first].bounds, ray.origin, inverseDirection, closest);
+        float secondEntry = rayBounds(nodes[second].bounds, ray.origin, inverseDirection, closest);
+        if (firstEntry > secondEntry)
+        {
+            std::swap(first, second);
+            std::swap(firstEntry, secondEntry);
+        }
+        if (secondEntry != FLT_MAX)
+            stack[stackSize++] = second;
+        if (firstEntry != FLT_MAX)
+            stack[stackSize++] = first;
+    }
+
+    if (hitLane < 0)
+        return result;
+    const BoxGroup &group = groups[hitGroup];
+    result.hit = true;
+    result.body = group.bodies[hitLane];
+    result.distance = closest;
+    result.point = ray.origin + ray.direction * closest;
+    // the face whose plane is closest to the hit point in units of the half extents
+    glm::vec3 local = result.point - groupCenter(group, hitLane);
+    float best = -1;
+    for (int i = 0; i < 3; i++)
+    {
+        glm::vec3 axis = groupAxis(group, hitLane, i);
+        float coordinate = glm::dot(local, axis) / group.halfExtents[i][hitLane];
+        if (std::abs(coordinate) > best)
+        {
+            best = std::abs(coordinate);
+            result.normal = coordinate < 0 ? -axis : axis;
+        }
+    }
+    return result;
+}
+
+void SceneQuery::rayCast(const Ray *rays, size_t count, RayHit *hits) const
+{
+    size_t batch = std::max<size_t>(batchSize, 1);
+    size_t batches = (count + batch - 1) / batch;
+    auto runBatch = [&](size_t b)
+    {
+        size_t end = std::min(count, (b + 1) * batch);
+        for (size_t i = b * batch; i < end; i++)
+            hits[i] = rayCast(rays[i]);
+    };
+    if (pool != nullptr)
+        pool->parallelFor(batches, runBatch);
+    else
+        for (size_t b = 0; b < batches; b++)
+            runBatch(b);
+}
+
+template <typename Callback>
+void SceneQuery::forEachOverlappingLeaf(const AABB &bounds, Callback &&callback) const
+{
+    if (nodes.empty())
+        return;
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        uint32_t index = stack[--stackSize];
+        const Node &node = nodes[index];
+        if (!node.bounds.overlaps(bounds))
+            continue;
+        if (node.isLeaf())
+        {
+            callback(groups[node.group], node.count);
+            continue;
+        }
+        stack[stackSize++] = node.secondChild;
+        stack[stackSize++] = index + 1;
+    }
+}
+
+void SceneQuery::overlapSphere(glm::vec3 center, float radius, std::vector<uint32_t> &bodies) const
+{
+    AABB sphereBounds{center - glm::vec3(radius), center + glm::vec3(radius)};
+    forEachOverlappingLeaf(sphereBounds, [&](const BoxGroup &group, uint32_t count)
+                           {
+                               for (uint32_t j = 0; j < count; j++)
+                               {
+                                   // closest point of the box to the sphere center
+                                   glm::vec3 toCenter = center - groupCenter(group, j);
+                                   glm::vec3 closest(0);
+                                   for (int i = 0; i < 3; i++)
+                                   {
+                                       glm::vec3 axis = groupAxis(group, j, i);
+                                       closest += axis * glm::clamp(glm::dot(toCenter, axis), -group.halfExtents[i][j], group.halfExtents[i][j]);
+                                   }
+                                   if (glm::length2(toCenter - closest) <= radius * radius)
+                                       bodies.push_back(group.bodies[j]);
+                               } });
+}
+
+void SceneQuery::overlapAABB(const AABB &bounds, std::vector<uint32_t> &bodies) const
+{
+    forEachOverlappingLeaf(bounds, [&](const BoxGroup &group, uint32_t count)
+                           {
+                               for (uint32_t j = 0; j < count; j++)
+                                   if (group.bounds[j].overlaps(bounds))
+                                       bodies.push_back(group.bodies[j]); });
+}
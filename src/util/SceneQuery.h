@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+#include <glm/glm.hpp>
+#include <util/AABB.h>
+#include <util/ThreadPool.h>
+#include <util/CollisionDetection.h>
+
+struct Ray
+{
+    glm::vec3 origin = glm::vec3(0);
+    // normalized, hit distances are along it
+    glm::vec3 direction = glm::vec3(0, 0, -1);
+    float maxDistance = FLT_MAX;
+};
+
+struct RayHit
+{
+    bool hit = false;
+    uint32_t body = 0;
+    float distance = FLT_MAX;
+    glm::vec3 point = glm::vec3(0);
+    // outward normal of the box face that was hit
+    glm::vec3 normal = glm::vec3(0);
+};
+
+// ray casts and overlap queries against box bodies, e.g. for picking or sensor rays
+//
+// Build it from the same BodyTransforms as BatchNarrowphase. The bounding volume hierarchy is built top down by
+// median splits and rebuilt completely by every build. Each leaf holds up to 4 boxes as structure of arrays,
+// so a ray is tested against all of them with the slab test in one loop.
+class SceneQuery
+{
+public:
+    explicit SceneQuery(ThreadPool *pool = nullptr) : pool(pool) {}
+
+    void build(const collisionTools::BodyTransforms &bodies);
+
+    // the closest box hit within ray.maxDistance, a ray starting inside a box hits it at distance 0
+    RayHit rayCast(const Ray &ray) const;
+    // hits[i] is rayCast(rays[i]), in parallel if a thread pool is given
+    void rayCast(const Ray *rays, size_t count, RayHit *hits) const;
+
+    // append the bodies whose box overlaps the sphere, in no particular order
+    void overlapSphere(glm::vec3 center, float radius, std::vector<uint32_t> &bodies) const;
+    // append the bodies whose world bounds overlap the given bounds
+    void overlapAABB(const AABB &bounds, std::vector<uint32_t> &bodies) const;
+
+    size_t size() const { return bodyCount; }
+    // rays per task handed to the thread pool
+    size_t batchSize = 64;
+
+    static constexpr int leafSize = 4;
+
+private:
+    struct Node
+    {
+        AABB bounds;
+        // inner nodes: the first child follows the node, secondChild is the other one
+        // leaves: index of the BoxGroup, and the number of boxes in it
+        uint32_t secondChild;
+        uint32_t group;
+        uint32_t count;
+
+        bool isLeaf() const { return count > 0; }
+    };
+
+    // up to leafSize boxes, lane j of every array belongs to body bodies[j]
+    struct BoxGroup
+    {
+        float centerX[leafSize], centerY[leafSize], centerZ[leafSize];
+        // axes[i] is the world direction of the box axis i
+        float axisX[3][leafSize], axisY[3][leafSize], axisZ[3][leafSize];
+        float halfExtents[3][leafSize];
+        AABB bounds[leafSize];
+        uint32_t bodies[leafSize];
+    };
+
+    uint32_t buildNode(uint32_t *first, uint32_t count);
+    // entry distance of the ray into each box of the group, FLT_MAX for misses
+    static void rayGroup(const BoxGroup &group, uint32_t count, const Ray &ray, float *entry);
+    static glm::vec3 groupAxis(const BoxGroup &group, int lane, int axis);
+    static glm::vec3 groupCenter(const BoxGroup &group, int lane);
+    template <typename Callback>
+    void forEachOverlappingLeaf(const AABB &bounds, Callback &&callback) const;
+
+    ThreadPool *pool;
+    size_t bodyCount = 0;
+    std::vector<Node> nodes;
+    std::vector<BoxGroup> groups;
+    // per body data during the build
+    std::vector<collisionTools::OBB> boxes;
+    std::vector<AABB> bodyBounds;
+    std::vector<glm::vec3> centers;
+};
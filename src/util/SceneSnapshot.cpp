@@ -0,0 +1,134 @@
+#include <util/SceneSnapshot.h>
+#include <fstream>
+#include <algorithm>
+
+namespace snapshot
+{
+    uint64_t hashBytes(const void *bytes, size_t size)
+    {
+        const uint8_t *data = static_cast<const uint8_t *>(bytes);
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= data[i];
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    uint64_t hashSceneName(const std::string &sceneName)
+    {
+        return hashBytes(sceneName.data(), sceneName.size());
+    }
+}
+
+bool SceneSnapshot::isValid(const std::string &sceneName) const
+{
+    if (data.size() < sizeof(snapshot::Header))
+        return false;
+    snapshot::Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != snapshot::magic || header.version != snapshot::version || header.headerSize != sizeof(snapshot::Header))
+        return false;
+    if (header.headerSize + header.payloadSize != data.size())
+        return false;
+    if (!sceneName.empty() && header.sceneHash != snapshot::hashSceneName(sceneName))
+        return false;
+    return true;
+}
+
+uint64_t SceneSnapshot::hash() const
+{
+    if (data.empty())
+        return 0;
+    return snapshot::hashBytes(data.data(), data.size());
+}
+
+bool SceneSnapshot::saveToFile(const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
+
+bool SceneSnapshot::loadFromFile(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+    std::streamsize fileSize = file.tellg();
+    file.seekg(0);
+    data.resize(static_cast<size_t>(fileSize));
+    file.read(reinterpret_cast<char *>(data.data()), fileSize);
+    if (!file || !isValid())
+    {
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+StateWriter::StateWriter(const std::string &sceneName) : sceneHash(snapshot::hashSceneName(sceneName))
+{
+    pending.data.resize(sizeof(snapshot::Header));
+}
+
+void StateWriter::writeBytes(const void *bytes, size_t size)
+{
+    size_t offset = pending.data.size();
+    // zero padding keeps identical states bitwise identical
+    pending.data.resize(snapshot::alignUp(offset + size), 0);
+    if (size > 0)
+        std::memcpy(pending.data.data() + offset, bytes, size);
+}
+
+SceneSnapshot StateWriter::finish()
+{
+    snapshot::Header header;
+    header.magic = snapshot::magic;
+    header.version = snapshot::version;
+    header.headerSize = sizeof(snapshot::Header);
+    header.payloadSize = pending.data.size() - sizeof(snapshot::Header);
+    header.sceneHash = sceneHash;
+    std::memcpy(pending.data.data(), &header, sizeof(header));
+    SceneSnapshot result = std::move(pending);
+    pending = SceneSnapshot();
+    pending.data.resize(sizeof(snapshot::Header));
+    return result;
+}
+
+StateReader::StateReader(const SceneSnapshot &source)
+{
+    if (!source.isValid())
+    {
+        hasFailed = true;
+        return;
+    }
+    data = source.data.data();
+    size = source.data.size();
+    offset = sizeof(snapshot::Header);
+}
+
+const uint8_t *StateReader::take(size_t bytes)
+{
+    if (hasFailed || bytes > size - offset)
+    {
+        hasFailed = true;
+        return nullptr;
+    }
+    const uint8_t *result = data + offset;
+    offset = std::min(size, snapshot::alignUp(offset + bytes));
+    return result;
+}
+
+bool StateReader::readBytes(void *bytes, size_t count)
+{
+    const uint8_t *source = take(count);
+    if (source == nullptr)
+        return false;
+    if (count > 0)
+        std::memcpy(bytes, source, count);
+    return true;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <filesystem>
+
+// binary snapshot of the state of a scene, written by Scene::saveState and restored by Scene::loadState
+//
+// layout: snapshot::Header, followed by the values in the order they were written.
+// Every value starts at a multiple of snapshot::alignment from the start of the snapshot,
+// so arrays can be used in place (StateReader::view), also from a memory mapped snapshot file.
+namespace snapshot
+{
+    constexpr uint64_t magic = 0x31504e5353505047; // "GPPSSNP1"
+    constexpr uint32_t version = 1;
+    constexpr size_t alignment = 16;
+
+    struct Header
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t payloadSize;
+        // FNV-1a hash of the scene name, to refuse loading a snapshot into a different scene
+        uint64_t sceneHash;
+    };
+    static_assert(sizeof(Header) % alignment == 0);
+
+    // FNV-1a hash
+    uint64_t hashBytes(const void *bytes, size_t size);
+    uint64_t hashSceneName(const std::string &sceneName);
+
+    inline size_t alignUp(size_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+struct SceneSnapshot
+{
+    // header and payload, as stored on disk
+    std::vector<uint8_t> data;
+
+    bool empty() const { return data.empty(); }
+    // check magic, version and size, and optionally that the snapshot belongs to the given scene
+    bool isValid(const std::string &sceneName = "") const;
+    // hash of the whole snapshot, identical states give identical hashes, 0 if empty
+    uint64_t hash() const;
+
+    bool saveToFile(const std::filesystem::path &path) const;
+    bool loadFromFile(const std::filesystem::path &path);
+};
+
+class StateWriter
+{
+public:
+    explicit StateWriter(const std::string &sceneName);
+
+    // write a trivially copyable value
+    template <typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be stored in a snapshot");
+        writeBytes(&value, sizeof(T));
+    }
+
+    // write the element count followed by the elements as one block
+    template <typename T>
+    void write(const std::vector<T> &values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be stored in a snapshot");
+        write<uint64_t>(values.size());
+        writeBytes(values.data(), values.size() * sizeof(T));
+    }
+
+    void writeBytes(const void *bytes, size_t size);
+
+    // fill in the header and hand out the snapshot, the writer is empty afterwards
+    SceneSnapshot finish();
+
+private:
+    SceneSnapshot pending;
+    uint64_t sceneHash;
+};
+
+class StateReader
+{
+public:
+    // the snapshot has to outlive the reader, values returned by view point into it
+    explicit StateReader(const SceneSnapshot &source);
+
+    template <typename T>
+    bool read(T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be stored in a snapshot");
+        return readBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    bool read(std::vector<T> &values)
+    {
+        size_t count = 0;
+        const T *elements = view<T>(count);
+        if (elements == nullptr)
+            return false;
+        values.assign(elements, elements + count);
+        return true;
+    }
+
+    // access an array written with StateWriter::write(std::vector) without copying it
+    template <typename T>
+    const T *view(size_t &count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable types can be stored in a snapshot");
+        uint64_t storedCount = 0;
+        if (!read(storedCount))
+            return nullptr;
+        // checked before multiplying, a corrupt count could wrap around to a small size
+        if (storedCount > (size - offset) / sizeof(T))
+        {
+            hasFailed = true;
+            return nullptr;
+        }
+        const uint8_t *bytes = take(static_cast<size_t>(storedCount) * sizeof(T));
+        if (bytes == nullptr)
+            return nullptr;
+        count = static_cast<size_t>(storedCount);
+        // empty arrays still need a non null pointer to signal success
+        return reinterpret_cast<const T *>(bytes);
+    }
+
+    bool readBytes(void *bytes, size_t count);
+
+    // true if a read went past the end of the snapshot
+    bool failed() const { return hasFailed; }
+
+private:
+    const uint8_t *take(size_t bytes);
+
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+    bool hasFailed = false;
+};
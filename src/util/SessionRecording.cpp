@@ -0,0 +1,59 @@
+#include <util/SessionRecording.h>
+
+namespace
+{
+    constexpr uint64_t recordingTag = 0x31434552534d4947; // "GIMSREC1"
+}
+
+size_t SessionRecording::stepCount() const
+{
+    size_t steps = 0;
+    for (auto &frame : frames)
+        steps += frame.substeps;
+    return steps;
+}
+
+bool SessionRecording::saveToFile(const std::filesystem::path &path) const
+{
+    StateWriter writer(sceneName);
+    writer.write(recordingTag);
+    writer.write(std::vector<char>(sceneName.begin(), sceneName.end()));
+    writer.write(initialState.data);
+    writer.write(frames);
+    writer.write<uint64_t>(stateEvents.size());
+    for (auto &state : stateEvents)
+        writer.write(state.data);
+    return writer.finish().saveToFile(path);
+}
+
+bool SessionRecording::loadFromFile(const std::filesystem::path &path)
+{
+    SceneSnapshot file;
+    if (!file.loadFromFile(path))
+        return false;
+    StateReader reader(file);
+    uint64_t tag = 0;
+    std::vector<char> name;
+    if (!reader.read(tag) || tag != recordingTag || !reader.read(name))
+        return false;
+    sceneName.assign(name.begin(), name.end());
+    if (!file.isValid(sceneName))
+        return false;
+    uint64_t eventCount = 0;
+    if (!reader.read(initialState.data) || !reader.read(frames) || !reader.read(eventCount))
+        return false;
+    stateEvents.clear();
+    for (uint64_t i = 0; i < eventCount; i++)
+    {
+        SceneSnapshot state;
+        if (!reader.read(state.data))
+            return false;
+        stateEvents.push_back(std::move(state));
+    }
+    for (auto &frame : frames)
+    {
+        if (frame.stateEvent >= static_cast<int64_t>(stateEvents.size()))
+            return false;
+    }
+    return !reader.failed();
+}
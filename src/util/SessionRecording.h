@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <imgui.h>
+#include <util/SceneSnapshot.h>
+
+// everything that influenced one frame of a scene: the ImGui input, the camera and the steps taken
+//
+// The input is the state ImGui reported after NewFrame, the camera the state after Camera::update.
+// State changes outside of simulateStep (GUI widgets, onDraw, reloads, restored snapshots) are stored as full snapshots.
+struct RecordedFrame
+{
+    // keyboard and gamepad keys, the mouse buttons are stored separately
+    static constexpr int firstKey = ImGuiKey_NamedKey_BEGIN;
+    static constexpr int keyCount = ImGuiKey_MouseLeft - ImGuiKey_NamedKey_BEGIN;
+    static constexpr int keyWords = (keyCount + 63) / 64;
+
+    enum Modifiers : uint32_t
+    {
+        ModCtrl = 1,
+        ModShift = 2,
+        ModAlt = 4,
+        ModSuper = 8,
+    };
+
+    // ImGui input
+    float deltaTime = 0;
+    glm::vec2 displaySize = glm::vec2(0);
+    glm::vec2 mousePos = glm::vec2(0);
+    glm::vec2 mouseWheel = glm::vec2(0);
+    uint32_t mouseDown = 0;
+    uint32_t modifiers = 0;
+    uint32_t wantCaptureMouse = 0;
+    uint32_t wantCaptureKeyboard = 0;
+    uint64_t keysDown[keyWords] = {};
+
+    // camera
+    glm::mat4 cameraView = glm::mat4(1);
+    glm::vec3 cameraPosition = glm::vec3(0);
+    int32_t cameraWidth = 0;
+    int32_t cameraHeight = 0;
+
+    // simulation
+    float timestep = 0;
+    uint32_t substeps = 0;
+    // index into SessionRecording::stateEvents to load before stepping, -1 if the state did not change since the last frame
+    int32_t stateEvent = -1;
+    // SceneSnapshot::hash of the state after the steps, 0 if the scene does not support snapshots
+    uint64_t stateHash = 0;
+
+    bool isKeyDown(int key) const
+    {
+        int i = key - firstKey;
+        return (keysDown[i / 64] >> (i % 64)) & 1;
+    }
+    void setKeyDown(int key, bool down)
+    {
+        int i = key - firstKey;
+        if (down)
+            keysDown[i / 64] |= uint64_t(1) << (i % 64);
+        else
+            keysDown[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+};
+
+// a recorded session of one scene, replayed with `--headless --replay <file>`
+//
+// stored in the snapshot file format: the scene name, the initial state, all frames and the state events
+struct SessionRecording
+{
+    std::string sceneName;
+    // state at the start of the recording, empty if the recording starts from a freshly initialized scene
+    SceneSnapshot initialState;
+    std::vector<RecordedFrame> frames;
+    std::vector<SceneSnapshot> stateEvents;
+
+    size_t stepCount() const;
+
+    bool saveToFile(const std::filesystem::path &path) const;
+    bool loadFromFile(const std::filesystem::path &path);
+};
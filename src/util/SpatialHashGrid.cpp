@@ -0,0 +1,172 @@
+#include <util/SpatialHashGrid.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <iostream>
+
+using collisionTools::BodyPair;
+
+uint32_t SpatialHashGrid::cellIndex(const glm::ivec3 &cell) const
+{
+    uint32_t hash = (static_cast<uint32_t>(cell.x) * 73856093u) ^ (static_cast<uint32_t>(cell.y) * 19349663u) ^ (static_cast<uint32_t>(cell.z) * 83492791u);
+    return hash & cellMask;
+}
+
+// the cell of a position, clamped so far away or non finite positions do not overflow the int conversion
+// clamping keeps neighboring cells neighbors, the bodies beyond the limit just share the outermost cells
+static glm::ivec3 cellOf(const glm::vec3 &position, float cellSize)
+{
+    const float limit = static_cast<float>(1 << 30);
+    glm::vec3 cell = glm::floor(position / cellSize);
+    glm::ivec3 result;
+    for (int i = 0; i < 3; i++)
+    {
+        // written so that NaN fails the first comparison
+        if (!(cell[i] > -limit))
+            result[i] = -(1 << 30);
+        else if (cell[i] < limit)
+            result[i] = static_cast<int>(cell[i]);
+        else
+            result[i] = 1 << 30;
+    }
+    return result;
+}
+
+bool SpatialHashGrid::build(const std::vector<AABB> &bounds)
+{
+    if (!(cellSize >= 0) || std::isinf(cellSize))
+    {
+        std::cerr << "SpatialHashGrid: the cell size has to be positive and finite, or 0 to pick it automatically, got " << cellSize << std::endl;
+        bodies.clear();
+        bodyCells.clear();
+        isLarge.clear();
+        largeBodies.clear();
+        cellStart.assign(2, 0);
+        sortedBodies.clear();
+        cellMask = 0;
+        return false;
+    }
+    bodies = bounds;
+    size_t count = bodies.size();
+
+    currentCellSize = cellSize;
+    if (currentCellSize <= 0 && count > 0)
+    {
+        // a few outliers should not blow up the cells of everyone else, they become large bodies instead
+        std::vector<float> extents(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::vec3 size = bodies[i].size();
+            extents[i] = std::max(size.x, std::max(size.y, size.z));
+        }
+        std::nth_element(extents.begin(), extents.begin() + count / 2, extents.end());
+        currentCellSize = 2 * extents[count / 2];
+    }
+    // all bodies without extent, or so small that dividing by the size overflows
+    if (!(currentCellSize >= std::numeric_limits<float>::min()) || std::isinf(currentCellSize))
+        currentCellSize = 1;
+
+    // about two hash cells per body keeps collisions between cells rare
+    uint32_t tableSize = 1;
+    while (tableSize < 2 * count)
+        tableSize <<= 1;
+    cellMask = tableSize - 1;
+
+    bodyCells.resize(count);
+    isLarge.assign(count, 0);
+    largeBodies.clear();
+    cellStart.assign(tableSize + 1, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 size = bodies[i].size();
+        if (size.x > currentCellSize || size.y > currentCellSize || size.z > currentCellSize)
+        {
+            isLarge[i] = 1;
+            largeBodies.push_back(static_cast<uint32_t>(i));
+            continue;
+        }
+        bodyCells[i] = cellOf(bodies[i].center(), currentCellSize);
+        cellStart[cellIndex(bodyCells[i]) + 1]++;
+    }
+    for (uint32_t c = 0; c < tableSize; c++)
+        cellStart[c + 1] += cellStart[c];
+    sortedBodies.resize(cellStart[tableSize]);
+    std::vector<uint32_t> next(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!isLarge[i])
+            sortedBodies[next[cellIndex(bodyCells[i])]++] = static_cast<uint32_t>(i);
+    }
+    return true;
+}
+
+void SpatialHashGrid::findPairs(uint32_t body, std::vector<BodyPair> &out) const
+{
+    size_t first = out.size();
+    const AABB &box = bodies[body];
+    if (isLarge[body])
+    {
+        // large bodies test everything, pairs of two large bodies are found from the smaller index
+        for (uint32_t other = 0; other < bodies.size(); other++)
+        {
+            if (other != body && (!isLarge[other] || other > body) && box.overlaps(bodies[other]))
+                out.push_back({std::min(body, other), std::max(body, other)});
+        }
+    }
+    else
+    {
+        // several neighbor cells may share a hash cell, visit every hash cell only once
+        uint32_t visited[27];
+        int visitedCount = 0;
+        for (int z = -1; z <= 1; z++)
+            for (int y = -1; y <= 1; y++)
+                for (int x = -1; x <= 1; x++)
+                {
+                    uint32_t cell = cellIndex(bodyCells[body] + glm::ivec3(x, y, z));
+                    if (std::find(visited, visited + visitedCount, cell) != visited + visitedCount)
+                        continue;
+                    visited[visitedCount++] = cell;
+                    for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; i++)
+                    {
+                        uint32_t other = sortedBodies[i];
+                        if (other > body && box.overlaps(bodies[other]))
+                            out.push_back({body, other});
+                    }
+                }
+    }
+    // the cells are visited in hash order, sort by the other body
+    std::sort(out.begin() + first, out.end(), [](const BodyPair &p1, const BodyPair &p2)
+              { return p1.a < p2.a || (p1.a == p2.a && p1.b < p2.b); });
+}
+
+const std::vector<BodyPair> &SpatialHashGrid::findPairs()
+{
+    size_t count = bodies.size();
+    size_t batch = std::max<size_t>(batchSize, 1);
+    size_t batches = (count + batch - 1) / batch;
+    batchPairs.resize(batches);
+    auto runBatch = [&](size_t b)
+    {
+        auto &out = batchPairs[b];
+        out.clear();
+        for (size_t i = b * batch; i < std::min(count, (b + 1) * batch); i++)
+            findPairs(static_cast<uint32_t>(i), out);
+    };
+    if (pool != nullptr)
+        pool->parallelFor(batches, runBatch);
+    else
+        for (size_t b = 0; b < batches; b++)
+            runBatch(b);
+
+    // batches in order keep the output independent of the scheduling
+    pairs.clear();
+    for (auto &out : batchPairs)
+        pairs.insert(pairs.end(), out.begin(), out.end());
+    if (!largeBodies.empty())
+    {
+        // a large body can pair with a smaller index, which breaks the order of the batches
+        std::sort(pairs.begin(), pairs.end(), [](const BodyPair &p1, const BodyPair &p2)
+                  { return p1.a < p2.a || (p1.a == p2.a && p1.b < p2.b); });
+    }
+    return pairs;
+}
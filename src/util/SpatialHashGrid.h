@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <util/AABB.h>
+#include <util/ThreadPool.h>
+#include <util/CollisionDetection.h>
+
+// uniform grid broadphase for many bodies of similar size, rebuilt from scratch every step
+//
+// Every body is sorted into the cell of its center with a counting sort over a hash table of cells,
+// so the bodies of a cell are contiguous in memory. Bodies can only overlap if their centers lie in neighboring cells
+// as long as no body is larger than a cell. Larger bodies are tested against all others, so keep them rare.
+class SpatialHashGrid
+{
+public:
+    // cellSize 0 picks twice the median body extent on every build
+    explicit SpatialHashGrid(float cellSize = 0, ThreadPool *pool = nullptr) : cellSize(cellSize), pool(pool) {}
+
+    // sort the bodies into the grid, bounds[i] belongs to body i
+    // returns false and leaves the grid empty if cellSize is negative or not finite
+    bool build(const std::vector<AABB> &bounds);
+
+    // all overlapping pairs of the last build, a < b, in ascending order. Generated in parallel if a thread pool is given
+    const std::vector<collisionTools::BodyPair> &findPairs();
+
+    float cellSize;
+    // bodies per pair generation task handed to the thread pool
+    size_t batchSize = 512;
+
+    float usedCellSize() const { return currentCellSize; }
+    // bodies larger than a cell in the last build
+    size_t largeBodyCount() const { return largeBodies.size(); }
+
+private:
+    uint32_t cellIndex(const glm::ivec3 &cell) const;
+    void findPairs(uint32_t body, std::vector<collisionTools::BodyPair> &out) const;
+
+    ThreadPool *pool;
+    float currentCellSize = 1;
+    std::vector<AABB> bodies;
+    std::vector<glm::ivec3> bodyCells;
+    std::vector<uint8_t> isLarge;
+    std::vector<uint32_t> largeBodies;
+    // counting sort result: the bodies of hash cell c are sortedBodies[cellStart[c]] to sortedBodies[cellStart[c + 1] - 1]
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> sortedBodies;
+    uint32_t cellMask = 0;
+
+    std::vector<std::vector<collisionTools::BodyPair>> batchPairs;
+    std::vector<collisionTools::BodyPair> pairs;
+};
@@ -0,0 +1,190 @@
+#include <util/SweepAndPrune.h>
+#include <algorithm>
+
+uint64_t SweepAndPrune::pairKey(uint32_t a, uint32_t b)
+{
+    if (a > b)
+        std::swap(a, b);
+    return (uint64_t(a) << 32) | b;
+}
+
+void SweepAndPrune::add(uint32_t body, const AABB &bounds)
+{
+    if (body >= bodies.size())
+        bodies.resize(body + 1);
+    if (bodies[body].active)
+    {
+        update(body, bounds);
+        return;
+    }
+    Body &entry = bodies[body];
+    entry.bounds = bounds;
+    entry.active = true;
+    // append behind everything else, the next sort moves the endpoints into place and reports the new overlaps
+    for (int axis = 0; axis < 3; axis++)
+    {
+        entry.minIndex[axis] = static_cast<uint32_t>(endpoints[axis].size());
+        endpoints[axis].push_back({bounds.min[axis], body << 1});
+        entry.maxIndex[axis] = static_cast<uint32_t>(endpoints[axis].size());
+        endpoints[axis].push_back({bounds.max[axis], (body << 1) | 1});
+    }
+    bodyCount++;
+    addedBodies++;
+}
+
+void SweepAndPrune::remove(uint32_t body)
+{
+    if (!contains(body))
+        return;
+    bodies[body].active = false;
+    bodyCount--;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        auto &list = endpoints[axis];
+        list.erase(std::remove_if(list.begin(), list.end(), [body](const Endpoint &endpoint)
+                                  { return endpoint.body() == body; }),
+                   list.end());
+        reindexAxis(axis);
+    }
+    for (auto it = overlappingPairs.begin(); it != overlappingPairs.end();)
+    {
+        if ((*it >> 32) == body || (*it & 0xffffffff) == body)
+            it = overlappingPairs.erase(it);
+        else
+            ++it;
+    }
+}
+
+void SweepAndPrune::update(uint32_t body, const AABB &bounds)
+{
+    if (!contains(body))
+        return;
+    Body &entry = bodies[body];
+    entry.bounds = bounds;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        endpoints[axis][entry.minIndex[axis]].value = bounds.min[axis];
+        endpoints[axis][entry.maxIndex[axis]].value = bounds.max[axis];
+    }
+}
+
+bool SweepAndPrune::contains(uint32_t body) const
+{
+    return body < bodies.size() && bodies[body].active;
+}
+
+void SweepAndPrune::clear()
+{
+    bodies.clear();
+    bodyCount = 0;
+    for (auto &list : endpoints)
+        list.clear();
+    overlappingPairs.clear();
+    pairs.clear();
+    addedBodies = 0;
+}
+
+void SweepAndPrune::reindexAxis(int axis)
+{
+    auto &list = endpoints[axis];
+    for (uint32_t i = 0; i < list.size(); i++)
+    {
+        Body &body = bodies[list[i].body()];
+        if (list[i].isMax())
+            body.maxIndex[axis] = i;
+        else
+            body.minIndex[axis] = i;
+    }
+}
+
+void SweepAndPrune::sortAxis(int axis)
+{
+    auto &list = endpoints[axis];
+    for (size_t i = 1; i < list.size(); i++)
+    {
+        Endpoint moving = list[i];
+        size_t j = i;
+        while (j > 0 && moving < list[j - 1])
+        {
+            const Endpoint &passed = list[j - 1];
+            Body &passedBody = bodies[passed.body()];
+            if (!moving.isMax() && passed.isMax())
+            {
+                // the moving body now starts before the passed one ends
+                if (bodies[moving.body()].bounds.overlaps(passedBody.bounds))
+                    overlappingPairs.insert(pairKey(moving.body(), passed.body()));
+            }
+            else if (moving.isMax() && !passed.isMax())
+            {
+                // the moving body now ends before the passed one starts
+                overlappingPairs.erase(pairKey(moving.body(), passed.body()));
+            }
+            if (passed.isMax())
+                passedBody.maxIndex[axis] = static_cast<uint32_t>(j);
+            else
+                passedBody.minIndex[axis] = static_cast<uint32_t>(j);
+            list[j] = passed;
+            j--;
+            lastSwaps++;
+        }
+        if (j != i)
+        {
+            list[j] = moving;
+            Body &movingBody = bodies[moving.body()];
+            if (moving.isMax())
+                movingBody.maxIndex[axis] = static_cast<uint32_t>(j);
+            else
+                movingBody.minIndex[axis] = static_cast<uint32_t>(j);
+        }
+    }
+}
+
+void SweepAndPrune::rebuild()
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        std::sort(endpoints[axis].begin(), endpoints[axis].end());
+        reindexAxis(axis);
+    }
+    // one sweep along x, checking the other axes directly
+    overlappingPairs.clear();
+    std::vector<uint32_t> open;
+    for (const Endpoint &endpoint : endpoints[0])
+    {
+        uint32_t body = endpoint.body();
+        if (endpoint.isMax())
+        {
+            open.erase(std::find(open.begin(), open.end(), body));
+            continue;
+        }
+        for (uint32_t other : open)
+        {
+            if (bodies[body].bounds.overlaps(bodies[other].bounds))
+                overlappingPairs.insert(pairKey(body, other));
+        }
+        open.push_back(body);
+    }
+}
+
+const std::vector<collisionTools::BodyPair> &SweepAndPrune::findPairs()
+{
+    lastSwaps = 0;
+    // added endpoints travel through the whole list, sorting from scratch is cheaper for more than a few of them
+    if (addedBodies > 16)
+        rebuild();
+    else
+    {
+        for (int axis = 0; axis < 3; axis++)
+            sortAxis(axis);
+    }
+    addedBodies = 0;
+
+    pairs.clear();
+    pairs.reserve(overlappingPairs.size());
+    for (uint64_t key : overlappingPairs)
+        pairs.push_back({static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key & 0xffffffff)});
+    // the set has no stable order, sort for reproducible results
+    std::sort(pairs.begin(), pairs.end(), [](const collisionTools::BodyPair &p1, const collisionTools::BodyPair &p2)
+              { return p1.a < p2.a || (p1.a == p2.a && p1.b < p2.b); });
+    return pairs;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_set>
+#include <util/AABB.h>
+#include <util/CollisionDetection.h>
+
+// incremental sweep and prune broadphase
+//
+// Keeps the bounds of all bodies as sorted lists of min and max endpoints on the x, y and z axis.
+// Bodies move little between steps, so the lists are nearly sorted and an insertion sort only does a few swaps.
+// Every swap of a min and a max endpoint starts or ends the overlap of two bodies on that axis, which updates the pair set.
+class SweepAndPrune
+{
+public:
+    // body ids are chosen by the caller, e.g. the index of the rigid body, and reported in the pairs
+    void add(uint32_t body, const AABB &bounds);
+    void remove(uint32_t body);
+    // set the bounds for the next findPairs
+    void update(uint32_t body, const AABB &bounds);
+    bool contains(uint32_t body) const;
+    size_t size() const { return bodyCount; }
+    void clear();
+
+    // sort the endpoints with the current bounds and return all overlapping pairs, a < b, in ascending order
+    const std::vector<collisionTools::BodyPair> &findPairs();
+
+    // endpoint swaps done by the last findPairs, a measure of how coherent the motion was
+    size_t lastSwaps = 0;
+
+private:
+    struct Endpoint
+    {
+        float value;
+        // body << 1 | isMax
+        uint32_t data;
+
+        uint32_t body() const { return data >> 1; }
+        bool isMax() const { return data & 1; }
+        // mins sort before maxes at equal values, so touching bounds overlap like in AABB::overlaps
+        bool operator<(const Endpoint &other) const
+        {
+            return value < other.value || (value == other.value && isMax() < other.isMax());
+        }
+    };
+
+    struct Body
+    {
+        AABB bounds;
+        // positions of the min and max endpoint in each axis list
+        uint32_t minIndex[3];
+        uint32_t maxIndex[3];
+        bool active = false;
+    };
+
+    static uint64_t pairKey(uint32_t a, uint32_t b);
+    void sortAxis(int axis);
+    void rebuild();
+    void reindexAxis(int axis);
+
+    std::vector<Body> bodies;
+    size_t bodyCount = 0;
+    std::vector<Endpoint> endpoints[3];
+    std::unordered_set<uint64_t> overlappingPairs;
+    std::vector<collisionTools::BodyPair> pairs;
+    // bodies added since the last findPairs, many of them are cheaper to sort from scratch
+    size_t addedBodies = 0;
+};
@@ -0,0 +1,72 @@
+#include <util/ThreadPool.h>
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 1; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &task)
+{
+    if (count == 0)
+        return;
+    if (workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            task(i);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        taskCount = count;
+        nextTask = 0;
+        busyWorkers = workers.size();
+        generation++;
+    }
+    condition.notify_all();
+    runTasks();
+    // the task has to stay alive until every worker let go of it
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]()
+                   { return busyWorkers == 0; });
+    currentTask = nullptr;
+}
+
+void ThreadPool::runTasks()
+{
+    for (size_t i = nextTask++; i < taskCount; i = nextTask++)
+        (*currentTask)(i);
+}
+
+void ThreadPool::workerLoop()
+{
+    size_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        condition.wait(lock, [&]()
+                       { return stop || generation != seenGeneration; });
+        if (stop)
+            return;
+        seenGeneration = generation;
+        lock.unlock();
+        runTasks();
+        lock.lock();
+        if (--busyWorkers == 0)
+            condition.notify_all();
+    }
+}
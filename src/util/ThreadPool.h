@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+// fixed set of worker threads that run the iterations of a loop in parallel
+//
+// The calling thread takes part in the work, so a pool with n threads uses n - 1 workers.
+class ThreadPool
+{
+public:
+    // 0 uses one thread per hardware thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t threadCount() const { return workers.size() + 1; }
+
+    // call task(i) for every i in [0, count) and wait until all calls returned
+    // the iterations are handed out one at a time, so long and short tasks balance out
+    void parallelFor(size_t count, const std::function<void(size_t)> &task);
+
+private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stop = false;
+
+    // the loop currently being run, valid while busyWorkers > 0
+    const std::function<void(size_t)> *currentTask = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextTask{0};
+    size_t busyWorkers = 0;
+    size_t generation = 0;
+};
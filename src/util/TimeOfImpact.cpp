@@ -0,0 +1,165 @@
+#include <util/TimeOfImpact.h>
+#include <util/GJK.h>
+#include <glm/gtx/norm.hpp>
+#include <algorithm>
+
+namespace collisionTools
+{
+    using vec3 = glm::vec3;
+    using quat = glm::quat;
+
+    static constexpr int toiMaxIterations = 32;
+
+    // box moving from the start to the end pose during the step
+    struct BoxMotion
+    {
+        vec3 startPosition, endPosition;
+        quat startRotation, endRotation;
+        vec3 halfExtents;
+
+        ConvexShape at(float t) const
+        {
+            return ConvexShape::box(glm::mix(startPosition, endPosition, t), glm::slerp(startRotation, endRotation, t), halfExtents);
+        }
+
+        // upper bound of how far any point of the box moves relative to its center
+        float rotationDistance() const
+        {
+            float angle = glm::angle(glm::conjugate(startRotation) * endRotation);
+            // the shorter way, as slerp takes it
+            if (angle > glm::pi<float>())
+                angle = 2 * glm::pi<float>() - angle;
+            return angle * glm::length(halfExtents);
+        }
+    };
+
+    static void decompose(const glm::mat4 &worldFromObj, vec3 &position, quat &rotation, vec3 &size)
+    {
+        glm::mat3 basis;
+        for (int i = 0; i < 3; i++)
+        {
+            size[i] = glm::length(vec3(worldFromObj[i]));
+            basis[i] = vec3(worldFromObj[i]) / size[i];
+        }
+        rotation = glm::normalize(glm::quat_cast(basis));
+        position = vec3(worldFromObj[3]);
+    }
+
+    static BoxMotion boxMotion(const glm::mat4 &start, const glm::mat4 &end)
+    {
+        BoxMotion motion;
+        vec3 size, endSize;
+        decompose(start, motion.startPosition, motion.startRotation, size);
+        decompose(end, motion.endPosition, motion.endRotation, endSize);
+        motion.halfExtents = size * 0.5f;
+        return motion;
+    }
+
+    static BoxMotion boxMotion(const BodyTransforms &start, const BodyTransforms &end, uint32_t body)
+    {
+        BoxMotion motion;
+        motion.startPosition = start.positions[body];
+        motion.endPosition = end.positions[body];
+        motion.startRotation = start.rotations[body];
+        motion.endRotation = end.rotations[body];
+        motion.halfExtents = start.scales[body] * 0.5f;
+        return motion;
+    }
+
+    static TOIResult conservativeAdvancement(const BoxMotion &a, const BoxMotion &b, float tolerance)
+    {
+        TOIResult result;
+        vec3 relativeTranslation = (b.endPosition - b.startPosition) - (a.endPosition - a.startPosition);
+        float rotationBound = a.rotationDistance() + b.rotationDistance();
+        float t = 0;
+        for (result.iterations = 0; result.iterations < toiMaxIterations; result.iterations++)
+        {
+            ConvexShape shapeA = a.at(t), shapeB = b.at(t);
+            GJKResult gjk = gjkDistance(shapeA, shapeB);
+            // bodies that start within the tolerance but move apart or slide along each other, e.g. a bullet resting on
+            // the floor, would stop at t = 0 and stick to their start pose, they only hit if the distance can shrink to 0
+            // during the step, which also keeps rounding in the normal of sliding bodies from counting as approach
+            if (result.iterations == 0 && !gjk.intersecting && gjk.distance > 0 && gjk.distance <= tolerance)
+            {
+                vec3 normal = (gjk.pointB - gjk.pointA) / gjk.distance;
+                if (-glm::dot(relativeTranslation, normal) + rotationBound < gjk.distance)
+                    return result;
+            }
+            if (gjk.intersecting || gjk.distance <= tolerance)
+            {
+                result.hit = true;
+                result.time = t;
+                result.initiallyOverlapping = gjk.intersecting && result.iterations == 0;
+                vec3 toB = gjk.intersecting ? shapeB.position - shapeA.position : gjk.pointB - gjk.pointA;
+                result.normalWorld = glm::length2(toB) > 0 ? -glm::normalize(toB) : vec3(0);
+                result.pointWorld = gjk.intersecting ? (shapeA.position + shapeB.position) * 0.5f : (gjk.pointA + gjk.pointB) * 0.5f;
+                return result;
+            }
+            // the distance shrinks at most this much over the whole step
+            vec3 normal = (gjk.pointB - gjk.pointA) / gjk.distance;
+            float approachBound = -glm::dot(relativeTranslation, normal) + rotationBound;
+            if (approachBound <= 0)
+                return result;
+            // aim inside the tolerance band instead of at its edge, so the loop ends without creeping towards it
+            t += (gjk.distance - 0.5f * tolerance) / approachBound;
+            if (t >= 1)
+                return result;
+            result.normalWorld = -normal;
+            result.pointWorld = (gjk.pointA + gjk.pointB) * 0.5f;
+        }
+        // grazing contacts where the rotation bound is loose converge slowly, t is still before the contact,
+        // so stopping there is safe for clamping, while reporting no hit would let the bodies tunnel
+        result.hit = true;
+        result.time = t;
+        return result;
+    }
+
+    TOIResult timeOfImpact(const glm::mat4 &startA, const glm::mat4 &endA, const glm::mat4 &startB, const glm::mat4 &endB, float tolerance)
+    {
+        return conservativeAdvancement(boxMotion(startA, endA), boxMotion(startB, endB), tolerance);
+    }
+
+    TOIResult timeOfImpact(const BodyTransforms &start, const BodyTransforms &end, uint32_t a, uint32_t b, float tolerance)
+    {
+        return conservativeAdvancement(boxMotion(start, end, a), boxMotion(start, end, b), tolerance);
+    }
+
+    AABB sweptAABB(const BodyTransforms &start, const BodyTransforms &end, uint32_t body)
+    {
+        // the bounding sphere of the box along the path of its center
+        float radius = glm::length(start.scales[body] * 0.5f);
+        AABB bounds{glm::min(start.positions[body], end.positions[body]), glm::max(start.positions[body], end.positions[body])};
+        return bounds.expanded(radius);
+    }
+
+    size_t clampBulletMotion(const BodyTransforms &start, BodyTransforms &end, const std::vector<uint8_t> &isBullet,
+                             const BodyPair *pairs, size_t pairCount, float tolerance)
+    {
+        std::vector<float> impactTimes(start.size(), 1.0f);
+        for (size_t i = 0; i < pairCount; i++)
+        {
+            uint32_t a = pairs[i].a, b = pairs[i].b;
+            if (!isBullet[a] && !isBullet[b])
+                continue;
+            TOIResult toi = timeOfImpact(start, end, a, b, tolerance);
+            // bodies that already overlap are left to the discrete narrowphase, clamping would freeze them
+            if (!toi.hit || toi.initiallyOverlapping)
+                continue;
+            if (isBullet[a])
+                impactTimes[a] = std::min(impactTimes[a], toi.time);
+            if (isBullet[b])
+                impactTimes[b] = std::min(impactTimes[b], toi.time);
+        }
+        size_t clamped = 0;
+        for (size_t body = 0; body < impactTimes.size(); body++)
+        {
+            float t = impactTimes[body];
+            if (t >= 1)
+                continue;
+            end.positions[body] = glm::mix(start.positions[body], end.positions[body], t);
+            end.rotations[body] = glm::slerp(start.rotations[body], end.rotations[body], t);
+            clamped++;
+        }
+        return clamped;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <util/AABB.h>
+#include <util/CollisionDetection.h>
+
+// continuous collision detection for boxes moving between the start and end pose of a step
+//
+// The boxes move linearly and rotate at a constant rate in between. Conservative advancement repeatedly measures their
+// distance with GJK and advances time by the distance divided by the fastest the boxes can approach each other,
+// which can never step past the first contact.
+namespace collisionTools
+{
+    struct TOIResult
+    {
+        // true if the boxes come within the tolerance of each other during the step, or may do so right after
+        // the time reached when running out of iterations, boxes that start within it only if they can touch
+        bool hit = false;
+        // fraction of the step at the first contact, 1 if there is none
+        float time = 1;
+        // as CollisionInfo, the direction of the impulse to A and the point halfway between the closest points
+        glm::vec3 normalWorld = glm::vec3(0);
+        glm::vec3 pointWorld = glm::vec3(0);
+        // the boxes already overlapped at the start pose
+        bool initiallyOverlapping = false;
+        int iterations = 0;
+    };
+
+    // time of impact of two boxes given by the worldFromObj matrices at the start and end of the step, like checkCollisionSAT
+    // the scale of the end matrices is ignored, the boxes keep their size
+    TOIResult timeOfImpact(const glm::mat4 &startA, const glm::mat4 &endA, const glm::mat4 &startB, const glm::mat4 &endB, float tolerance = 0.001f);
+
+    // the same for bodies of BodyTransforms
+    TOIResult timeOfImpact(const BodyTransforms &start, const BodyTransforms &end, uint32_t a, uint32_t b, float tolerance = 0.001f);
+
+    // bounds of everything the body can touch during the step, whatever the rotation, for the broadphase of the bullets
+    AABB sweptAABB(const BodyTransforms &start, const BodyTransforms &end, uint32_t body);
+
+    // move the bodies flagged as bullets only up to their earliest time of impact with any other body of the pairs,
+    // so fast or thin bodies stop at the surface instead of passing through it, the other bodies keep their end pose
+    // pairs without a bullet are skipped, returns the number of bullets that were clamped
+    size_t clampBulletMotion(const BodyTransforms &start, BodyTransforms &end, const std::vector<uint8_t> &isBullet,
+                             const BodyPair *pairs, size_t pairCount, float tolerance = 0.001f);
+}
@@ -0,0 +1,92 @@
+#include <util/TimingHistory.h>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <fstream>
+
+TimingHistory::TimingHistory(std::string name, size_t capacity) : name(std::move(name)), samples(std::max<size_t>(capacity, 1), 0.0)
+{
+}
+
+void TimingHistory::add(double seconds)
+{
+    samples[next] = seconds;
+    next = (next + 1) % samples.size();
+    if (next == 0)
+        full = true;
+}
+
+void TimingHistory::clear()
+{
+    next = 0;
+    full = false;
+}
+
+size_t TimingHistory::size() const
+{
+    return full ? samples.size() : next;
+}
+
+size_t TimingHistory::capacity() const
+{
+    return samples.size();
+}
+
+double TimingHistory::sample(size_t i) const
+{
+    size_t oldest = full ? next : 0;
+    return samples[(oldest + i) % samples.size()];
+}
+
+TimingHistory::Summary TimingHistory::summary() const
+{
+    Summary result;
+    size_t count = size();
+    if (count == 0)
+        return result;
+    std::vector<double> sorted(samples.begin(), samples.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+    result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / count;
+    result.p50 = percentile(sorted, 0.5);
+    result.p95 = percentile(sorted, 0.95);
+    result.p99 = percentile(sorted, 0.99);
+    result.max = sorted.back();
+    return result;
+}
+
+double TimingHistory::percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+bool TimingHistory::writeCSV(const std::filesystem::path &path, const std::vector<TimingHistory *> &histories)
+{
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    size_t rows = 0;
+    file << "sample";
+    for (auto history : histories)
+    {
+        file << "," << history->name << "_ms";
+        rows = std::max(rows, history->size());
+    }
+    file << "\n";
+    for (size_t row = 0; row < rows; row++)
+    {
+        file << row;
+        for (auto history : histories)
+        {
+            // align the newest samples if the histories have different lengths
+            size_t offset = rows - history->size();
+            file << ",";
+            if (row >= offset)
+                file << history->sample(row - offset) * 1000;
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
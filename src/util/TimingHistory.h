@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <filesystem>
+
+// ring buffer of the most recent timing samples of one phase (e.g. simulation step), with percentile statistics
+class TimingHistory
+{
+public:
+    struct Summary
+    {
+        double mean = 0;
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    TimingHistory(std::string name, size_t capacity = 1000);
+
+    // add a sample in seconds, overwrites the oldest one once the buffer is full
+    void add(double seconds);
+    void clear();
+
+    size_t size() const;
+    size_t capacity() const;
+    // the i-th sample in seconds, 0 is the oldest
+    double sample(size_t i) const;
+
+    // statistics over all samples currently in the buffer
+    Summary summary() const;
+
+    // nearest rank percentile, p in [0, 1], of samples sorted in ascending order
+    static double percentile(const std::vector<double> &sorted, double p);
+
+    // write the histories as columns in milliseconds, one row per sample, oldest first
+    static bool writeCSV(const std::filesystem::path &path, const std::vector<TimingHistory *> &histories);
+
+    const std::string name;
+
+private:
+    std::vector<double> samples;
+    size_t next = 0;
+    bool full = false;
+};